@@ -6,18 +6,28 @@
 #include <cstring>
 #include <cstdlib>
 #include <cstdio>
+#include <cerrno>
+#include <array>
+#include <string>
+#include <thread>
+#include <random>
+#include <algorithm>
 
 #ifdef _WIN32
     #include <windows.h>
     #include <malloc.h> // Для _aligned_malloc и _aligned_free
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
 #endif
 
-#include <bits/fs_fwd.h>
-
 #include "page-cache.h"
 
-#define PRE_RESULT_LOG(opType, cType, time, speed) std::cout << std::format("[{}] [{}] Записано {} МБ за {:.6f} сек. ({:.4f} МБ/c)", opType, cType, TOTAL_SIZE / 1024 / 1024, time, speed) << std::endl
-#define RESULT_LOG(opType, cType, time, speed) std::cout << std::format("[{}] [{}] Записано {} МБ за {:.6f} сек. ({:.4f} МБ/c)", opType, cType, TOTAL_SIZE / 1024 / 1024, time, speed) << std::endl
+// printf вместо std::format: <format> есть не во всех стандартных библиотеках (например, libstdc++ < 13)
+// Операции чтения (opType начинается с READ) печатаются как «Прочитано», остальные — как «Записано»
+#define RESULT_VERB(opType) (std::strncmp(opType, "READ", 4) == 0 ? "Прочитано" : "Записано")
+#define PRE_RESULT_LOG(opType, cType, time, speed) std::printf("[%s] [%s] %s %zu МБ за %.6f сек. (%.4f МБ/c)\n", opType, cType, RESULT_VERB(opType), TOTAL_SIZE / 1024 / 1024, time, speed)
+#define RESULT_LOG(opType, cType, time, speed) std::printf("[%s] [%s] %s %zu МБ за %.6f сек. (%.4f МБ/c)\n", opType, cType, RESULT_VERB(opType), TOTAL_SIZE / 1024 / 1024, time, speed)
 
 // Размер блока и общий объём данных (100 МБ)
 const size_t BLOCK_SIZE = 4096;                  // 4 КБ
@@ -53,6 +63,32 @@ std::array<double, 2> benchmarkOSCacheWrite(const std::string &filename) {
     return {durationSec, throughputMBs};
 }
 
+#ifndef _WIN32
+// Открытие файла в обход кэша ОС: O_DIRECT + O_DSYNC — аналог FILE_FLAG_NO_BUFFERING |
+// FILE_FLAG_WRITE_THROUGH. Файловые системы без O_DIRECT (tmpfs) открываются через кэш ОС
+static int openNoCache(const std::string &filename, int extraFlags) {
+    int flags = O_WRONLY | O_CREAT | O_DSYNC | extraFlags;
+#ifdef O_DIRECT
+    int fd = open(filename.c_str(), flags | O_DIRECT, 0644);
+    if (fd != -1 || errno != EINVAL) {
+        return fd;
+    }
+#endif
+    return open(filename.c_str(), flags, 0644);
+}
+
+// Запись NUM_BLOCKS блоков из выровненного буфера подряд с начала файла
+static bool writeBlocksNoCache(int fd, const char *buffer) {
+    for (size_t i = 0; i < NUM_BLOCKS; ++i) {
+        if (write(fd, buffer, BLOCK_SIZE) != static_cast<ssize_t>(BLOCK_SIZE)) {
+            std::cerr << "Ошибка write на блоке " << i << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+#endif
+
 // Функция для бенчмарка без кэширования ОС
 std::array<double, 2> benchmarkNoCacheWrite(const std::string &filename) {
 #ifdef _WIN32
@@ -94,7 +130,27 @@ std::array<double, 2> benchmarkNoCacheWrite(const std::string &filename) {
 
     return {durationSec, throughputMBs};
 #else
-    std::cerr << "NoCache benchmark доступен только на Windows." << std::endl;
+    int fd = openNoCache(filename, O_TRUNC);
+    if (fd == -1) {
+        std::cerr << "Ошибка open: " << filename << std::endl;
+        return {0, 0};
+    }
+    char *buffer = static_cast<char*>(std::aligned_alloc(BLOCK_SIZE, BLOCK_SIZE));
+    memset(buffer, 'B', BLOCK_SIZE);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    writeBlocksNoCache(fd, buffer);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::free(buffer);
+    close(fd);
+
+    double durationSec = std::chrono::duration<double>(end - start).count();
+    double throughputMBs = (TOTAL_SIZE / (1024.0 * 1024.0)) / durationSec;
+
+    PRE_RESULT_LOG("WRITE", "No Cache", durationSec, throughputMBs);
+
+    return {durationSec, throughputMBs};
 #endif
 }
 
@@ -262,7 +318,40 @@ std::array<double, 2> benchmarkNoCacheReWrite(const std::string &filename) {
 
     return {durationSec, throughputMBs};
 #else
-    std::cerr << "NoCache benchmark доступен только на Windows." << std::endl;
+    char *buffer = static_cast<char*>(std::aligned_alloc(BLOCK_SIZE, BLOCK_SIZE));
+    memset(buffer, 'B', BLOCK_SIZE);
+
+    // Создаем файл и записываем начальные данные
+    int fd = openNoCache(filename, O_TRUNC);
+    if (fd == -1 || !writeBlocksNoCache(fd, buffer)) {
+        std::cerr << "Ошибка записи начальных данных: " << filename << std::endl;
+        std::free(buffer);
+        if (fd != -1) {
+            close(fd);
+        }
+        return {0, 0};
+    }
+    close(fd);
+
+    // Перезапись данных
+    fd = openNoCache(filename, 0);
+    if (fd == -1) {
+        std::cerr << "Ошибка open: " << filename << std::endl;
+        std::free(buffer);
+        return {0, 0};
+    }
+    auto start = std::chrono::high_resolution_clock::now();
+    writeBlocksNoCache(fd, buffer);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::free(buffer);
+    close(fd);
+
+    double durationSec = std::chrono::duration<double>(end - start).count();
+    double throughputMBs = (TOTAL_SIZE / (1024.0 * 1024.0)) / durationSec;
+    PRE_RESULT_LOG("REWRITE", "No Cache", durationSec, throughputMBs);
+
+    return {durationSec, throughputMBs};
 #endif
 }
 
@@ -317,8 +406,116 @@ std::array<double, 2> benchmarkCustomCacheReWrite(const std::string &filename) {
     return {durationSec, throughputMBs};
 }
 
+// Смешанная нагрузка для сравнения политик вытеснения: горячий индекс (четверть ёмкости кэша),
+// перемежающийся с холодным сканированием объёмом в 4 ёмкости кэша.
+// Файл пуст, поэтому чтения за концом файла не нагружают диск и сравнивается только hit/miss.
+void benchmarkCustomCachePolicies(const std::string &filename) {
+    const int policies[] = {LAB2_POLICY_FIFO, LAB2_POLICY_LRU, LAB2_POLICY_CLOCK, LAB2_POLICY_2Q, LAB2_POLICY_S3FIFO};
+    const char *names[] = {"FIFO", "LRU", "CLOCK", "2Q", "S3-FIFO"};
+    const size_t hotBlocks = NUM_BLOCKS / 4;
+    const size_t scanBlocks = NUM_BLOCKS * 4;
+
+    std::vector<char> buffer(BLOCK_SIZE);
+    print_hm(); // сброс счётчиков после предыдущих бенчмарков
+
+    for (size_t run = 0; run < 2 * std::size(policies); ++run) {
+        // вторая половина прогонов — те же политики с фильтром допуска TinyLFU
+        size_t p = run % std::size(policies);
+        bool admission = run >= std::size(policies);
+        lab2_set_eviction_policy(policies[p]);
+        lab2_set_admission_filter(admission);
+        int fd = lab2_open(filename.c_str());
+        if (fd == -1) {
+            std::cerr << "Ошибка lab2_open: " << filename << std::endl;
+            return;
+        }
+
+        std::srand(42);
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < hotBlocks; ++i) {
+            lab2_lseek(fd, i * BLOCK_SIZE, SEEK_SET);
+            lab2_read(fd, buffer.data(), BLOCK_SIZE);
+        }
+        for (size_t i = 0; i < scanBlocks; ++i) {
+            lab2_lseek(fd, (std::rand() % hotBlocks) * BLOCK_SIZE, SEEK_SET);
+            lab2_read(fd, buffer.data(), BLOCK_SIZE);
+            lab2_lseek(fd, (hotBlocks + i) * BLOCK_SIZE, SEEK_SET);
+            lab2_read(fd, buffer.data(), BLOCK_SIZE);
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        lab2_close(fd);
+
+        double durationSec = std::chrono::duration<double>(end - start).count();
+        std::printf("[MIXED] [Custom Cache, %s%s] %.6f сек. ", names[p], admission ? " + TinyLFU" : "", durationSec);
+        std::fflush(stdout);
+        print_hm();
+    }
+    lab2_set_eviction_policy(LAB2_POLICY_S3FIFO);
+    lab2_set_admission_filter(0);
+}
+
+// Многопоточное чтение: каждый поток читает случайные блоки своего файла в пределах
+// рабочего набора, который целиком помещается в кэш. Показывает, как пропускная способность
+// попаданий растёт с числом потоков (ядер).
+void benchmarkCustomCacheThreads(const std::string &filename) {
+    const size_t opsPerThread = 200000;
+    unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    const size_t blocksPerThread = NUM_BLOCKS / (2 * maxThreads);
+
+    std::vector<unsigned> threadCounts;
+    for (unsigned t = 1; t < maxThreads; t *= 2) {
+        threadCounts.push_back(t);
+    }
+    threadCounts.push_back(maxThreads);
+
+    print_hm(); // сброс счётчиков после предыдущих бенчмарков
+    for (unsigned threads : threadCounts) {
+        std::vector<int> fds(threads);
+        for (unsigned t = 0; t < threads; ++t) {
+            fds[t] = lab2_open((filename + "." + std::to_string(t)).c_str());
+            if (fds[t] == -1) {
+                std::cerr << "Ошибка lab2_open: " << filename << std::endl;
+                return;
+            }
+        }
+
+        auto worker = [&](unsigned t) {
+            std::vector<char> buffer(BLOCK_SIZE);
+            std::mt19937 rng(t);
+            for (size_t i = 0; i < opsPerThread; ++i) {
+                lab2_lseek(fds[t], (rng() % blocksPerThread) * BLOCK_SIZE, SEEK_SET);
+                lab2_read(fds[t], buffer.data(), BLOCK_SIZE);
+            }
+        };
+
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threads; ++t) {
+            workers.emplace_back(worker, t);
+        }
+        for (auto &w : workers) {
+            w.join();
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+
+        for (unsigned t = 0; t < threads; ++t) {
+            lab2_close(fds[t]);
+            remove((filename + "." + std::to_string(t)).c_str());
+        }
+
+        double durationSec = std::chrono::duration<double>(end - start).count();
+        double totalMB = threads * opsPerThread * BLOCK_SIZE / (1024.0 * 1024.0);
+        std::printf("[THREADS] [Custom Cache, %u потоков] Прочитано %.0f МБ за %.6f сек. (%.4f МБ/c) ",
+                    threads, totalMB, durationSec, totalMB / durationSec);
+        std::fflush(stdout);
+        print_hm();
+    }
+}
+
 int main() {
+#ifdef _WIN32
     SetConsoleOutputCP(CP_UTF8);
+#endif
 
     // Файлы для каждого теста
     std::string fileOS = "benchmark_os.dat";
@@ -405,5 +602,11 @@ int main() {
     benchmarkNoCacheReWrite(fileNoCache_2);
     benchmarkCustomCacheReWrite(fileCustom_2);
 
+    std::string filePolicies = "benchmark_policies.dat";
+    benchmarkCustomCachePolicies(filePolicies);
+    remove(filePolicies.c_str());
+
+    benchmarkCustomCacheThreads("benchmark_threads.dat");
+
     return 0;
 }
@@ -0,0 +1,80 @@
+//
+// Реализация фильтра допуска TinyLFU.
+//
+
+#include "page-cache-admission.h"
+
+#include <algorithm>
+
+namespace {
+
+// Перемешивание 64-битного значения (финализатор splitmix64)
+uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+// Независимые соли строк sketch
+constexpr uint64_t ROW_SEEDS[] = {
+    0x9e3779b97f4a7c15ULL, 0xc2b2ae3d27d4eb4fULL, 0x165667b19e3779f9ULL, 0xd6e8feb86659fd93ULL,
+};
+
+} // namespace
+
+AdmissionFilter::AdmissionFilter(size_t capacity) {
+    size_t width = 1;
+    while (width < std::max<size_t>(capacity, 16)) {
+        width <<= 1;
+    }
+    width_mask = width - 1;
+    counters.assign(DEPTH * width, 0);
+    // окно выборки в 10 ёмкостей кэша, как в TinyLFU
+    sample_size = 10 * std::max<size_t>(capacity, 1);
+}
+
+size_t AdmissionFilter::slot(const BlockKey& key, int row) const {
+    uint64_t raw = (static_cast<uint64_t>(static_cast<uint32_t>(key.first)) << 40)
+                 ^ offset_to_block(key.second);
+    return row * (width_mask + 1) + (mix64(raw + ROW_SEEDS[row]) & width_mask);
+}
+
+void AdmissionFilter::record(const BlockKey& key) {
+    // "консервативное" увеличение: растут только минимальные счётчики
+    uint32_t current = estimate(key);
+    if (current < MAX_COUNT) {
+        for (int row = 0; row < DEPTH; ++row) {
+            uint8_t& counter = counters[slot(key, row)];
+            if (counter == current) {
+                counter++;
+            }
+        }
+    }
+    if (++additions >= sample_size) {
+        age();
+    }
+}
+
+uint32_t AdmissionFilter::estimate(const BlockKey& key) const {
+    uint32_t result = MAX_COUNT;
+    for (int row = 0; row < DEPTH; ++row) {
+        result = std::min<uint32_t>(result, counters[slot(key, row)]);
+    }
+    return result;
+}
+
+bool AdmissionFilter::admit(const BlockKey& candidate, const BlockKey& victim) const {
+    // при равенстве оставляем жертву: однократные обращения сканирования не вытесняют рабочий набор
+    return estimate(candidate) > estimate(victim);
+}
+
+// Старение: все счётчики делятся пополам, чтобы старая популярность постепенно забывалась
+void AdmissionFilter::age() {
+    for (uint8_t& counter : counters) {
+        counter >>= 1;
+    }
+    additions /= 2;
+}
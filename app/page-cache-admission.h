@@ -0,0 +1,43 @@
+//
+// Фильтр допуска TinyLFU (Einziger, Friedman, Manes): перед вытеснением сравнивает
+// оценку частоты обращений к новому блоку и к жертве и пропускает в кэш только более
+// востребованный. Частоты хранятся в count-min sketch с периодическим старением.
+//
+
+#ifndef PAGE_CACHE_ADMISSION_H
+#define PAGE_CACHE_ADMISSION_H
+
+#include "page-cache-block.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class AdmissionFilter {
+public:
+    // capacity — ёмкость кэша в блоках; от неё зависят ширина sketch и период старения
+    explicit AdmissionFilter(size_t capacity);
+
+    // Учёт обращения к блоку (попадание или промах)
+    void record(const BlockKey& key);
+
+    // Оценка частоты обращений к блоку
+    uint32_t estimate(const BlockKey& key) const;
+
+    // true, если кандидат должен вытеснить жертву
+    bool admit(const BlockKey& candidate, const BlockKey& victim) const;
+
+private:
+    static constexpr int DEPTH = 4;            // число строк sketch
+    static constexpr uint8_t MAX_COUNT = 15;   // насыщение счётчика (4 бита, как в TinyLFU)
+
+    size_t slot(const BlockKey& key, int row) const;
+    void age();
+
+    std::vector<uint8_t> counters;  // DEPTH строк по width счётчиков
+    size_t width_mask;              // width - 1, width — степень двойки
+    size_t sample_size;             // число обращений между старениями
+    size_t additions = 0;
+};
+
+#endif // PAGE_CACHE_ADMISSION_H
@@ -0,0 +1,338 @@
+//
+// Движки асинхронного чтения (см. page-cache-aio.h).
+//
+
+#include "page-cache-aio.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef PAGE_CACHE_HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+#define AIO_POOL_THREADS 4    // Потоков в запасном пуле
+#define AIO_QUEUE_DEPTH 256   // Заявок одновременно в работе у io_uring
+
+namespace {
+
+// Пул потоков: каждая заявка выполняется синхронным io_preadv в одном из рабочих потоков
+class ThreadPoolEngine : public IoEngine {
+public:
+    explicit ThreadPoolEngine(size_t threads) {
+        for (size_t i = 0; i < threads; ++i) {
+            workers.emplace_back([this] { work(); });
+        }
+    }
+
+    ~ThreadPoolEngine() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        queued.notify_all();
+        for (std::thread &worker : workers) {
+            worker.join();
+        }
+    }
+
+    void submit_read(io_handle_t handle, const IoVec *iov, int iovcnt, off_t offset, IoCallback done) override {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back({handle, std::vector<IoVec>(iov, iov + iovcnt), offset, std::move(done)});
+        }
+        queued.notify_one();
+    }
+
+    const char *name() const override { return "thread pool"; }
+
+private:
+    struct Request {
+        io_handle_t handle;
+        std::vector<IoVec> iov;
+        off_t offset;
+        IoCallback done;
+    };
+
+    // Рабочий поток; при остановке сначала выполняет оставшиеся заявки
+    void work() {
+        for (;;) {
+            std::unique_lock<std::mutex> lock(mutex);
+            queued.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (queue.empty()) {
+                return;
+            }
+            Request request = std::move(queue.front());
+            queue.pop_front();
+            lock.unlock();
+            request.done(io_preadv(request.handle, request.iov.data(), static_cast<int>(request.iov.size()),
+                                   request.offset));
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable queued;
+    std::deque<Request> queue;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+};
+
+#ifdef PAGE_CACHE_HAVE_IO_URING
+
+// io_uring без liburing: кольца отображаются в память напрямую. Заявки отправляются под
+// submit_mutex (один io_uring_enter на заявку), завершения собирает отдельный поток.
+// В работе не больше AIO_QUEUE_DEPTH заявок, поэтому очередь завершений не переполняется
+class UringEngine : public IoEngine {
+public:
+    // nullptr, если ядро не даёт создать кольцо (нет поддержки, запрещено seccomp и т. п.)
+    static std::unique_ptr<UringEngine> create(unsigned entries) {
+        std::unique_ptr<UringEngine> engine(new UringEngine());
+        if (!engine->setup(entries)) {
+            return nullptr;
+        }
+        engine->reaper = std::thread([e = engine.get()] { e->reap(); });
+        return engine;
+    }
+
+    ~UringEngine() override {
+        if (reaper.joinable()) {
+            std::unique_lock<std::mutex> lock(submit_mutex);
+            slot_free.wait(lock, [this] { return in_flight == 0; });
+            // пустая операция с user_data = 0 будит и останавливает поток завершений
+            io_uring_sqe *sqe = next_sqe();
+            sqe->opcode = IORING_OP_NOP;
+            submit_locked();
+            lock.unlock();
+            reaper.join();
+        }
+        if (sqes != MAP_FAILED) {
+            munmap(sqes, sqes_size);
+        }
+        if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr) {
+            munmap(cq_ptr, cq_size);
+        }
+        if (sq_ptr != MAP_FAILED) {
+            munmap(sq_ptr, sq_size);
+        }
+        if (ring_fd != -1) {
+            close(ring_fd);
+        }
+    }
+
+    void submit_read(io_handle_t handle, const IoVec *iov, int iovcnt, off_t offset, IoCallback done) override {
+        auto *request = new Request{handle, {}, 0, offset, 0, std::move(done)};
+        request->iov.resize(iovcnt);
+        for (int i = 0; i < iovcnt; ++i) {
+            request->iov[i].iov_base = iov[i].base;
+            request->iov[i].iov_len = iov[i].len;
+        }
+        std::unique_lock<std::mutex> lock(submit_mutex);
+        slot_free.wait(lock, [this] { return in_flight < depth; });
+        in_flight++;
+        push_locked(request);
+    }
+
+    const char *name() const override { return "io_uring"; }
+
+private:
+    struct Request {
+        int fd;
+        std::vector<iovec> iov;
+        size_t first;        // первый ещё не заполненный буфер
+        off_t offset;        // смещение буфера iov[first]
+        size_t bytes;        // прочитано всего
+        IoCallback done;
+    };
+
+    UringEngine() = default;
+
+    static int uring_setup(unsigned entries, io_uring_params *params) {
+        return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    static int uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+        return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+    }
+
+    static unsigned load_acquire(unsigned *ptr) {
+        return std::atomic_ref<unsigned>(*ptr).load(std::memory_order_acquire);
+    }
+
+    static void store_release(unsigned *ptr, unsigned value) {
+        std::atomic_ref<unsigned>(*ptr).store(value, std::memory_order_release);
+    }
+
+    bool setup(unsigned entries) {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        ring_fd = uring_setup(entries, &params);
+        if (ring_fd < 0) {
+            ring_fd = -1;
+            return false;
+        }
+        depth = params.sq_entries;
+
+        sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap) {
+            sq_size = cq_size = std::max(sq_size, cq_size);
+        }
+        sq_ptr = mmap(nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+        if (sq_ptr == MAP_FAILED) {
+            return false;
+        }
+        cq_ptr = single_mmap ? sq_ptr
+                             : mmap(nullptr, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd,
+                                    IORING_OFF_CQ_RING);
+        if (cq_ptr == MAP_FAILED) {
+            return false;
+        }
+        sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe *>(mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                                ring_fd, IORING_OFF_SQES));
+        if (sqes == MAP_FAILED) {
+            return false;
+        }
+
+        char *sq = static_cast<char *>(sq_ptr);
+        sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+        sq_mask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+        sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+        char *cq = static_cast<char *>(cq_ptr);
+        cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+        cq_mask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    // Следующий элемент очереди отправки (вызывается под submit_mutex). Очередь пуста:
+    // каждая заявка уходит в ядро сразу в submit_locked
+    io_uring_sqe *next_sqe() {
+        unsigned tail = *sq_tail;
+        io_uring_sqe *sqe = &sqes[tail & sq_mask];
+        memset(sqe, 0, sizeof(*sqe));
+        sq_array[tail & sq_mask] = tail & sq_mask;
+        return sqe;
+    }
+
+    void submit_locked() {
+        store_release(sq_tail, *sq_tail + 1);
+        while (uring_enter(ring_fd, 1, 0, 0) < 0 && (errno == EINTR || errno == EAGAIN || errno == EBUSY)) {
+        }
+    }
+
+    // Отправка (или повторная отправка остатка) заявки; вызывается под submit_mutex
+    void push_locked(Request *request) {
+        io_uring_sqe *sqe = next_sqe();
+        sqe->opcode = IORING_OP_READV;
+        sqe->fd = request->fd;
+        sqe->addr = reinterpret_cast<uint64_t>(request->iov.data() + request->first);
+        sqe->len = static_cast<uint32_t>(request->iov.size() - request->first);
+        sqe->off = static_cast<uint64_t>(request->offset);
+        sqe->user_data = reinterpret_cast<uint64_t>(request);
+        submit_locked();
+    }
+
+    // Поток завершений
+    void reap() {
+        for (;;) {
+            // ошибка (например, EINTR) не страшна: очередь завершений всё равно проверяется
+            uring_enter(ring_fd, 0, 1, IORING_ENTER_GETEVENTS);
+            unsigned head = *cq_head;
+            while (head != load_acquire(cq_tail)) {
+                io_uring_cqe cqe = cqes[head & cq_mask];
+                store_release(cq_head, ++head);
+                if (cqe.user_data == 0) {
+                    return;
+                }
+                complete(reinterpret_cast<Request *>(cqe.user_data), cqe.res);
+            }
+        }
+    }
+
+    // Короткое чтение не у конца файла дочитывается, как в io_preadv
+    void complete(Request *request, int res) {
+        if (res == -EINTR || res == -EAGAIN) {
+            std::lock_guard<std::mutex> lock(submit_mutex);
+            push_locked(request);
+            return;
+        }
+        if (res > 0) {
+            request->bytes += res;
+            request->offset += res;
+            size_t n = res;
+            while (request->first < request->iov.size() && n >= request->iov[request->first].iov_len) {
+                n -= request->iov[request->first].iov_len;
+                request->first++;
+            }
+            if (request->first < request->iov.size()) {
+                request->iov[request->first].iov_base = static_cast<char *>(request->iov[request->first].iov_base) + n;
+                request->iov[request->first].iov_len -= n;
+                std::lock_guard<std::mutex> lock(submit_mutex);
+                push_locked(request);
+                return;
+            }
+        }
+        // res == 0 — конец файла
+        request->done(res < 0 ? -1 : static_cast<ssize_t>(request->bytes));
+        delete request;
+        {
+            std::lock_guard<std::mutex> lock(submit_mutex);
+            in_flight--;
+        }
+        slot_free.notify_all();
+    }
+
+    int ring_fd = -1;
+    unsigned depth = 0;
+    void *sq_ptr = MAP_FAILED;
+    void *cq_ptr = MAP_FAILED;
+    io_uring_sqe *sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+    size_t sq_size = 0;
+    size_t cq_size = 0;
+    size_t sqes_size = 0;
+    unsigned *sq_tail = nullptr;
+    unsigned sq_mask = 0;
+    unsigned *sq_array = nullptr;
+    unsigned *cq_head = nullptr;
+    unsigned *cq_tail = nullptr;
+    unsigned cq_mask = 0;
+    io_uring_cqe *cqes = nullptr;
+
+    std::mutex submit_mutex;
+    std::condition_variable slot_free;
+    unsigned in_flight = 0;
+    std::thread reaper;
+};
+
+#endif // PAGE_CACHE_HAVE_IO_URING
+
+std::unique_ptr<IoEngine> make_engine() {
+#ifdef PAGE_CACHE_HAVE_IO_URING
+    if (std::unique_ptr<UringEngine> engine = UringEngine::create(AIO_QUEUE_DEPTH)) {
+        return engine;
+    }
+#endif
+    return std::make_unique<ThreadPoolEngine>(AIO_POOL_THREADS);
+}
+
+} // namespace
+
+IoEngine &io_engine() {
+    static std::unique_ptr<IoEngine> engine = make_engine();
+    return *engine;
+}
@@ -0,0 +1,33 @@
+//
+// Асинхронное чтение для page-cache: заявка выполняется в фоне, вызывающий поток не ждёт,
+// и несколько заявок могут быть в работе одновременно. Движок выбирается при первом обращении:
+//  - io_uring (Linux; заголовок ищется при конфигурации, см. PAGE_CACHE_HAVE_IO_URING,
+//    а ядро может запретить io_uring_setup — тогда используется запасной вариант);
+//  - пул потоков, выполняющих обычный io_preadv.
+//
+
+#ifndef PAGE_CACHE_AIO_H
+#define PAGE_CACHE_AIO_H
+
+#include "page-cache-io.h"
+
+#include <functional>
+
+// Завершение заявки: число прочитанных байт (меньше запрошенного — конец файла) или -1
+using IoCallback = std::function<void(ssize_t)>;
+
+class IoEngine {
+public:
+    virtual ~IoEngine() = default;
+
+    // Векторное чтение iov[0..iovcnt) начиная с offset. Массив iov копируется, буферы должны
+    // жить до вызова done. done вызывается в потоке движка и не должен отправлять новые заявки
+    virtual void submit_read(io_handle_t handle, const IoVec *iov, int iovcnt, off_t offset, IoCallback done) = 0;
+
+    virtual const char *name() const = 0;
+};
+
+// Движок процесса; создаётся при первом вызове, перед завершением дожидается всех заявок
+IoEngine &io_engine();
+
+#endif // PAGE_CACHE_AIO_H
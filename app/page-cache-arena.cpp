@@ -0,0 +1,59 @@
+//
+// Арена кадров кэша (см. page-cache-arena.h).
+//
+
+#include "page-cache-arena.h"
+
+CacheBlock* FrameArena::grow(size_t frame_count, bool huge) {
+    size_t index = segment_count.load(std::memory_order_relaxed);
+    if (frame_count == 0 || index == MAX_SEGMENTS) {
+        return nullptr;
+    }
+    FrameBacking backing;
+    char* frames = static_cast<char*>(io_alloc_frames(frame_count * block_size, block_size, huge, &backing));
+    if (frames == nullptr) {
+        return nullptr;
+    }
+    Segment& segment = segments[index];
+    segment.frames = frames;
+    segment.frame_count = frame_count;
+    segment.frame_size = block_size;
+    segment.backing = backing;
+    segment.blocks = std::make_unique<CacheBlock[]>(frame_count);
+    for (size_t i = 0; i < frame_count; ++i) {
+        segment.blocks[i].data = frames + i * block_size;
+    }
+    frames_total += frame_count;
+    if (backing != FRAMES_REGULAR) {
+        huge_total += frame_count * block_size;
+    }
+    segment_count.store(index + 1, std::memory_order_release);
+    return &segment.blocks[0];
+}
+
+void FrameArena::clear() {
+    size_t count = segment_count.load(std::memory_order_relaxed);
+    segment_count.store(0, std::memory_order_release);
+    for (size_t i = 0; i < count; ++i) {
+        io_free_frames(segments[i].frames, segments[i].frame_count * segments[i].frame_size, segments[i].backing);
+        segments[i] = Segment{};
+    }
+    frames_total = 0;
+    huge_total = 0;
+}
+
+CacheBlock* FrameArena::block_of(const void* ptr) const {
+    const char* p = static_cast<const char*>(ptr);
+    size_t count = segment_count.load(std::memory_order_acquire);
+    for (size_t i = 0; i < count; ++i) {
+        const Segment& segment = segments[i];
+        if (p >= segment.frames && p < segment.frames + segment.frame_count * segment.frame_size) {
+            return &segment.blocks[(p - segment.frames) / segment.frame_size];
+        }
+    }
+    return nullptr;
+}
+
+FrameArena::~FrameArena() {
+    clear();
+}
@@ -0,0 +1,66 @@
+//
+// Арена кадров кэша: данные блоков выделяются крупными выровненными сегментами,
+// метаданные блоков (CacheBlock) лежат отдельным плотным массивом на сегмент. Блок владеет
+// своим кадром всё время жизни сегмента, поэтому промах не выделяет и не обнуляет память.
+// Сегмент может лежать на больших страницах (lab2_config.huge_pages): кадры идут подряд
+// без заголовков, поэтому каждая страница TLB покрывает 512 кадров по 4 КБ, а поиск
+// и политики работают только с метаданными. Рост кэша (lab2_resize) добавляет сегмент;
+// при уменьшении кадры лишних блоков возвращаются ОС (io_discard), а сами блоки остаются
+// в арене для следующего роста.
+//
+
+#ifndef PAGE_CACHE_ARENA_H
+#define PAGE_CACHE_ARENA_H
+
+#include "page-cache-block.h"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+class FrameArena {
+public:
+    FrameArena() = default;
+    ~FrameArena();
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // Новый сегмент из frame_count кадров по block_size байт, выровненных по block_size,
+    // при huge — по возможности на больших страницах (см. io_alloc_frames). Возвращает
+    // метаданные первого блока сегмента (блоки сегмента идут подряд) или nullptr, если
+    // память не выделена или сегментов уже MAX_SEGMENTS. Вызовы grow и clear
+    // сериализует вызывающий
+    CacheBlock* grow(size_t frame_count, bool huge);
+
+    // Освобождение всех сегментов. Ни один блок арены не должен использоваться
+    void clear();
+
+    // Общее число кадров во всех сегментах
+    size_t size() const { return frames_total; }
+
+    // Байт кадров на больших страницах (явных или прозрачных)
+    size_t huge_bytes() const { return huge_total; }
+
+    // Метаданные блока, кадру которого принадлежит адрес ptr, или nullptr.
+    // Безопасно параллельно с grow
+    CacheBlock* block_of(const void* ptr) const;
+
+private:
+    static constexpr size_t MAX_SEGMENTS = 64;
+
+    struct Segment {
+        char* frames = nullptr;               // frame_count * frame_size байт
+        size_t frame_count = 0;
+        size_t frame_size = 0;
+        FrameBacking backing = FRAMES_REGULAR;
+        std::unique_ptr<CacheBlock[]> blocks; // blocks[i].data указывает на кадр i
+    };
+
+    Segment segments[MAX_SEGMENTS];
+    std::atomic<size_t> segment_count{0};  // Опубликованные сегменты (release в grow)
+    size_t frames_total = 0;
+    std::atomic<size_t> huge_total{0};  // Читается статистикой параллельно с grow
+};
+
+#endif // PAGE_CACHE_ARENA_H
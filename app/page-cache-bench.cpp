@@ -0,0 +1,553 @@
+//
+// Бенчмарк кэша страниц на типовых нагрузках: последовательное, случайное и zipf-чтение,
+// смешанные чтение/запись, зависимость от размера рабочего набора и многопоточность.
+// Каждая нагрузка прогоняется через кэш (lab2_*), буферизованный POSIX-ввод-вывод
+// (кэш ОС) и O_DIRECT. Для каждого прогона печатаются пропускная способность,
+// задержки p50/p99 и доля попаданий (только для кэша); --csv пишет то же в CSV.
+//
+// --huge-pages=on размещает кадры кэша на больших страницах, --huge-pages=compare прогоняет
+// только случайное чтение с попаданиями на обычных и больших страницах и печатает разницу.
+// --victim-mb=N включает ярус сжатых вытесненных блоков (lab2_set_victim_tier) на N МБ.
+// --groups=compare прогоняет чтение индекса вперемешку с потоковой записью большого файла
+// без квот и с резервом памяти для индекса (lab2_set_group_limits).
+//
+// Запуск: bench [--ops=N] [--dir=PATH] [--csv=FILE] [--only=ПОДСТРОКА] [--targets=cache,posix,direct]
+//              [--cache-mb=N] [--huge-pages=off|on|compare] [--groups=compare] [--victim-mb=N]
+//
+
+#include "page-cache.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+constexpr size_t BLOCK = 4096;
+constexpr size_t DEFAULT_CACHE_MB = 100;       // Память кэша по умолчанию (как в page-cache.cpp)
+constexpr size_t PREFILL_CHUNK = 1024 * 1024;  // Порция заполнения файла перед прогоном
+
+// Файл, через который идёт нагрузка. Все методы потокобезопасны (позиционный ввод-вывод)
+class Target {
+public:
+    virtual ~Target() = default;
+    virtual const char* name() const = 0;
+    virtual bool open(const std::string& path) = 0;  // создаёт пустой файл
+    virtual ssize_t pread(void* buf, size_t count, off_t offset) = 0;
+    virtual ssize_t pwrite(const void* buf, size_t count, off_t offset) = 0;
+    virtual int fsync() = 0;
+    virtual void close() = 0;
+    virtual bool counts_hits() const { return false; }
+};
+
+class CacheTarget : public Target {
+public:
+    const char* name() const override { return "cache"; }
+    bool open(const std::string& path) override {
+        fd = lab2_open(path.c_str());
+        return fd != -1;
+    }
+    ssize_t pread(void* buf, size_t count, off_t offset) override { return lab2_pread(fd, buf, count, offset); }
+    ssize_t pwrite(const void* buf, size_t count, off_t offset) override { return lab2_pwrite(fd, buf, count, offset); }
+    int fsync() override { return lab2_fsync(fd); }
+    void close() override { lab2_close(fd); }
+    bool counts_hits() const override { return true; }
+    int descriptor() const { return fd; }
+
+private:
+    int fd = -1;
+};
+
+// Буферизованный ввод-вывод через кэш ОС или прямой (O_DIRECT)
+class PosixTarget : public Target {
+public:
+    explicit PosixTarget(bool direct) : direct(direct) {}
+    const char* name() const override { return direct ? "direct" : "posix"; }
+    bool open(const std::string& path) override {
+        int flags = O_RDWR | O_CREAT | O_TRUNC;
+#ifdef O_DIRECT
+        if (direct) {
+            flags |= O_DIRECT;
+        }
+#else
+        if (direct) {
+            return false;
+        }
+#endif
+        fd = ::open(path.c_str(), flags, 0644);
+        return fd != -1;
+    }
+    ssize_t pread(void* buf, size_t count, off_t offset) override { return ::pread(fd, buf, count, offset); }
+    ssize_t pwrite(const void* buf, size_t count, off_t offset) override { return ::pwrite(fd, buf, count, offset); }
+    int fsync() override { return ::fsync(fd); }
+    void close() override { ::close(fd); }
+
+private:
+    bool direct;
+    int fd = -1;
+};
+
+enum class Pattern { SEQUENTIAL, UNIFORM, ZIPF };
+
+struct Workload {
+    std::string name;
+    Pattern pattern;
+    double read_ratio;  // доля чтений, остальное — запись
+    size_t file_bytes;
+    unsigned threads;
+};
+
+struct Options {
+    size_t ops = 100000;  // операций на прогон (делятся между потоками)
+    std::string dir = ".";
+    std::string csv;
+    std::string only;
+    std::string targets = "cache,posix,direct";
+    size_t cache_bytes = DEFAULT_CACHE_MB * 1024 * 1024;  // память кэша (lab2_init); от неё зависят
+                                                          // размеры файлов нагрузок
+    std::string huge_pages = "off";                       // off, on или compare
+    bool compare_groups = false;                          // --groups=compare
+    size_t victim_bytes = 0;                              // память яруса вытесненных блоков
+};
+
+// Распределение Ципфа (theta = 0.99) по блокам файла. Ранги переставлены умножением на
+// простое число, чтобы горячие блоки не лежали подряд и не помогали упреждающему чтению
+class ZipfBlocks {
+public:
+    ZipfBlocks(size_t blocks, double theta = 0.99) : cdf(blocks) {
+        double sum = 0;
+        for (size_t i = 0; i < blocks; ++i) {
+            sum += 1.0 / std::pow(static_cast<double>(i + 1), theta);
+            cdf[i] = sum;
+        }
+        for (double& value : cdf) {
+            value /= sum;
+        }
+    }
+
+    size_t next(std::mt19937_64& rng) const {
+        double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+        size_t rank = std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin();
+        rank = std::min(rank, cdf.size() - 1);
+        return (rank * 2654435761ull) % cdf.size();
+    }
+
+private:
+    std::vector<double> cdf;
+};
+
+struct RunResult {
+    double seconds = 0;
+    uint64_t ops = 0;
+    double p50_us = 0;
+    double p99_us = 0;
+    double hit_rate = -1;  // -1 — цель не считает попадания
+    double victim_rate = 0;  // доля обращений, обслуженных ярусом вытесненных блоков
+    bool ok = true;
+};
+
+static char* alloc_block_buffer() {
+    return static_cast<char*>(std::aligned_alloc(BLOCK, BLOCK));
+}
+
+// Заполнение файла перед прогоном, чтобы чтения шли по настоящим данным. Данные — текстовые
+// записи с номерами и случайными полями: сжимаются в несколько раз, как журналы и таблицы,
+// но не вырождаются в повтор одного байта (это важно для яруса вытесненных блоков)
+static bool prefill(Target& target, size_t bytes) {
+    char* chunk = static_cast<char*>(std::aligned_alloc(BLOCK, PREFILL_CHUNK));
+    std::mt19937_64 rng(bytes);
+    bool ok = true;
+    for (size_t offset = 0; offset < bytes && ok; offset += PREFILL_CHUNK) {
+        size_t count = std::min(PREFILL_CHUNK, bytes - offset);
+        for (size_t pos = 0; pos < count;) {
+            char record[80];
+            int len = std::snprintf(record, sizeof(record), "%012zx user=%04u state=%s amount=%06u\n",
+                                    offset + pos, static_cast<unsigned>(rng() % 10000),
+                                    rng() % 4 ? "active" : "closed", static_cast<unsigned>(rng() % 1000000));
+            size_t n = std::min(static_cast<size_t>(len), count - pos);
+            memcpy(chunk + pos, record, n);
+            pos += n;
+        }
+        ok = target.pwrite(chunk, count, static_cast<off_t>(offset)) == static_cast<ssize_t>(count);
+    }
+    std::free(chunk);
+    return ok && target.fsync() == 0;
+}
+
+static RunResult run_workload(Target& target, const Workload& workload, const Options& options,
+                              const ZipfBlocks* zipf) {
+    RunResult result;
+    std::string path = options.dir + "/bench_" + target.name() + ".dat";
+    std::remove(path.c_str());
+    if (!target.open(path)) {
+        std::fprintf(stderr, "Ошибка открытия %s (%s)\n", path.c_str(), target.name());
+        result.ok = false;
+        return result;
+    }
+    if (!prefill(target, workload.file_bytes)) {
+        std::fprintf(stderr, "Ошибка заполнения %s (%s)\n", path.c_str(), target.name());
+        target.close();
+        std::remove(path.c_str());
+        result.ok = false;
+        return result;
+    }
+
+    size_t blocks = workload.file_bytes / BLOCK;
+    size_t ops_per_thread = options.ops / workload.threads;
+    std::vector<std::vector<uint32_t>> latencies(workload.threads);
+    std::atomic<bool> failed{false};
+    lab2_reset_stats();
+
+    auto worker = [&](unsigned t) {
+        std::vector<uint32_t>& samples = latencies[t];
+        samples.reserve(ops_per_thread);
+        std::mt19937_64 rng(t + 1);
+        std::uniform_real_distribution<double> coin(0.0, 1.0);
+        char* buffer = alloc_block_buffer();
+        memset(buffer, 'W', BLOCK);
+        size_t sequential = blocks * t / workload.threads;
+        for (size_t i = 0; i < ops_per_thread; ++i) {
+            size_t block;
+            switch (workload.pattern) {
+                case Pattern::SEQUENTIAL:
+                    block = sequential++ % blocks;
+                    break;
+                case Pattern::UNIFORM:
+                    block = rng() % blocks;
+                    break;
+                default:
+                    block = zipf->next(rng);
+                    break;
+            }
+            bool read = workload.read_ratio >= 1.0 || coin(rng) < workload.read_ratio;
+            auto start = std::chrono::steady_clock::now();
+            ssize_t done = read ? target.pread(buffer, BLOCK, static_cast<off_t>(block * BLOCK))
+                                : target.pwrite(buffer, BLOCK, static_cast<off_t>(block * BLOCK));
+            auto end = std::chrono::steady_clock::now();
+            if (done != static_cast<ssize_t>(BLOCK)) {
+                failed = true;
+                break;
+            }
+            samples.push_back(static_cast<uint32_t>(
+                std::min<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count(), UINT32_MAX)));
+        }
+        std::free(buffer);
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < workload.threads; ++t) {
+        threads.emplace_back(worker, t);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    if (target.counts_hits()) {
+        lab2_stats stats;
+        lab2_get_stats(&stats);
+        uint64_t accesses = stats.hits + stats.misses;
+        result.hit_rate = accesses > 0 ? static_cast<double>(stats.hits) / accesses : 0;
+        result.victim_rate = accesses > 0 ? static_cast<double>(stats.victim_hits) / accesses : 0;
+    }
+    // запись грязных данных на диск в замер не входит: кэш ОС тоже откладывает её
+    target.close();
+    std::remove(path.c_str());
+
+    std::vector<uint32_t> all;
+    for (auto& samples : latencies) {
+        all.insert(all.end(), samples.begin(), samples.end());
+    }
+    result.ok = !failed && !all.empty();
+    if (!result.ok) {
+        return result;
+    }
+    result.ops = all.size();
+    result.seconds = std::chrono::duration<double>(end - start).count();
+    auto percentile = [&](double q) {
+        auto it = all.begin() + static_cast<size_t>(q * (all.size() - 1));
+        std::nth_element(all.begin(), it, all.end());
+        return *it / 1000.0;
+    };
+    result.p50_us = percentile(0.50);
+    result.p99_us = percentile(0.99);
+    return result;
+}
+
+static std::vector<Workload> make_workloads(size_t cache_bytes) {
+    const size_t half = cache_bytes / 2;
+    std::vector<Workload> workloads = {
+        {"seq-read", Pattern::SEQUENTIAL, 1.0, half, 1},
+        {"rand-read", Pattern::UNIFORM, 1.0, half, 1},
+        {"zipf-read", Pattern::ZIPF, 1.0, cache_bytes * 2, 1},
+        {"mixed-90r", Pattern::ZIPF, 0.9, half, 1},
+        {"mixed-50r", Pattern::ZIPF, 0.5, half, 1},
+        {"mixed-10r", Pattern::ZIPF, 0.1, half, 1},
+    };
+    // рабочий набор от четверти до четырёх ёмкостей кэша
+    for (int percent : {25, 50, 100, 200, 400}) {
+        workloads.push_back({"sweep-" + std::to_string(percent) + "%", Pattern::UNIFORM, 1.0,
+                             cache_bytes / 100 * percent, 1});
+    }
+    unsigned max_threads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned threads = 2; threads <= max_threads * 2; threads *= 2) {
+        workloads.push_back({"threads-" + std::to_string(threads), Pattern::UNIFORM, 1.0, half, threads});
+    }
+    return workloads;
+}
+
+static bool parse_options(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&](const char* prefix) -> const char* {
+            size_t len = std::strlen(prefix);
+            return arg.compare(0, len, prefix) == 0 ? arg.c_str() + len : nullptr;
+        };
+        if (const char* v = value("--ops=")) {
+            options.ops = std::strtoull(v, nullptr, 10);
+        } else if (const char* v = value("--dir=")) {
+            options.dir = v;
+        } else if (const char* v = value("--csv=")) {
+            options.csv = v;
+        } else if (const char* v = value("--only=")) {
+            options.only = v;
+        } else if (const char* v = value("--targets=")) {
+            options.targets = v;
+        } else if (const char* v = value("--cache-mb=")) {
+            options.cache_bytes = std::strtoull(v, nullptr, 10) * 1024 * 1024;
+        } else if (const char* v = value("--huge-pages=")) {
+            options.huge_pages = v;
+        } else if (const char* v = value("--victim-mb=")) {
+            options.victim_bytes = std::strtoull(v, nullptr, 10) * 1024 * 1024;
+        } else if (arg == "--groups=compare") {
+            options.compare_groups = true;
+        } else {
+            options.ops = 0;
+            break;
+        }
+    }
+    bool huge_ok = options.huge_pages == "off" || options.huge_pages == "on" || options.huge_pages == "compare";
+    if (options.ops == 0 || options.cache_bytes == 0 || !huge_ok) {
+        std::fprintf(stderr, "Использование: %s [--ops=N] [--dir=PATH] [--csv=FILE] [--only=ПОДСТРОКА] "
+                             "[--targets=cache,posix,direct] [--cache-mb=N] [--huge-pages=off|on|compare] [--groups=compare] "
+                             "[--victim-mb=N]\n",
+                     argv[0]);
+        return false;
+    }
+    return true;
+}
+
+// Случайное чтение блоков, которые все лежат в кэше, с кадрами на обычных и на больших
+// страницах. Диск в замер не попадает, и разница — это в основном промахи TLB при обращении
+// к кадрам; она растёт с размером кэша (--cache-mb)
+static int compare_huge_pages(const Options& options) {
+    Workload workload{"hit-read", Pattern::UNIFORM, 1.0, options.cache_bytes / 2, 1};
+    std::printf("%-7s %9s %11s %9s %10s %10s %6s\n", "frames", "huge", "ops/s", "MB/s", "p50, us", "p99, us", "hit");
+    double regular_ops = 0;
+    for (int huge : {0, 1}) {
+        lab2_config config{options.cache_bytes, BLOCK, huge};
+        if (lab2_init(&config) != 0) {
+            std::fprintf(stderr, "Ошибка настройки кэша (%zu МБ)\n", options.cache_bytes / (1024 * 1024));
+            return 1;
+        }
+        CacheTarget target;
+        RunResult result = run_workload(target, workload, options, nullptr);
+        if (!result.ok) {
+            std::printf("%-7s ошибка\n", huge ? "huge" : "regular");
+            return 1;
+        }
+        lab2_stats stats;
+        lab2_get_stats(&stats);
+        double ops_per_sec = result.ops / result.seconds;
+        std::printf("%-7s %6llu MB %11.0f %9.1f %10.2f %10.2f %5.1f%%\n", huge ? "huge" : "regular",
+                    static_cast<unsigned long long>(stats.huge_page_bytes / (1024 * 1024)), ops_per_sec,
+                    ops_per_sec * BLOCK / (1024.0 * 1024.0), result.p50_us, result.p99_us, result.hit_rate * 100);
+        if (huge == 0) {
+            regular_ops = ops_per_sec;
+        } else {
+            if (stats.huge_page_bytes == 0) {
+                std::printf("Большие страницы недоступны, кадры на обычных страницах\n");
+            }
+            std::printf("Разница: %+.1f%%\n", (ops_per_sec / regular_ops - 1) * 100);
+        }
+        std::fflush(stdout);
+    }
+    return 0;
+}
+
+// Случайное чтение индекса (половина кэша) вперемешку с последовательной записью файла
+// вдвое больше кэша. Под LRU поток записи вымывает индекс из кэша; с квотами индекс
+// получает резерв во весь свой размер, а поток записи — предел в остаток кэша
+static int compare_groups(const Options& options) {
+    const size_t index_bytes = options.cache_bytes / 2;
+    const size_t bulk_bytes = options.cache_bytes * 2;
+    std::string index_path = options.dir + "/bench_index.dat";
+    std::string bulk_path = options.dir + "/bench_bulk.dat";
+    std::printf("%-7s %11s %10s %10s %10s %10s\n", "quotas", "index hit", "p50, us", "p99, us", "index MB", "bulk MB");
+    for (int quotas : {0, 1}) {
+        lab2_config config{options.cache_bytes, BLOCK, 0};
+        if (lab2_init(&config) != 0 || lab2_set_eviction_policy(LAB2_POLICY_LRU) != 0) {
+            std::fprintf(stderr, "Ошибка настройки кэша (%zu МБ)\n", options.cache_bytes / (1024 * 1024));
+            return 1;
+        }
+        lab2_set_group_limits(1, quotas ? index_bytes : 0, 0);
+        lab2_set_group_limits(2, 0, quotas ? options.cache_bytes - index_bytes : 0);
+
+        CacheTarget index;
+        CacheTarget bulk;
+        std::remove(index_path.c_str());
+        std::remove(bulk_path.c_str());
+        if (!index.open(index_path) || !bulk.open(bulk_path) || !prefill(index, index_bytes)) {
+            std::fprintf(stderr, "Ошибка подготовки файлов в %s\n", options.dir.c_str());
+            return 1;
+        }
+        lab2_set_file_group(index.descriptor(), 1);
+        lab2_set_file_group(bulk.descriptor(), 2);
+        lab2_reset_stats();
+
+        std::vector<uint32_t> samples;
+        samples.reserve(options.ops);
+        std::mt19937_64 rng(1);
+        char* buffer = alloc_block_buffer();
+        memset(buffer, 'W', BLOCK);
+        bool ok = true;
+        for (size_t i = 0; i < options.ops && ok; ++i) {
+            off_t offset = static_cast<off_t>(rng() % (index_bytes / BLOCK) * BLOCK);
+            auto start = std::chrono::steady_clock::now();
+            ok = index.pread(buffer, BLOCK, offset) == static_cast<ssize_t>(BLOCK);
+            auto end = std::chrono::steady_clock::now();
+            samples.push_back(static_cast<uint32_t>(
+                std::min<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count(), UINT32_MAX)));
+            off_t bulk_offset = static_cast<off_t>(i * BLOCK % bulk_bytes);
+            ok = ok && bulk.pwrite(buffer, BLOCK, bulk_offset) == static_cast<ssize_t>(BLOCK);
+        }
+        std::free(buffer);
+
+        lab2_group_stats index_stats;
+        lab2_group_stats bulk_stats;
+        lab2_get_group_stats(1, &index_stats);
+        lab2_get_group_stats(2, &bulk_stats);
+        index.close();
+        bulk.close();
+        std::remove(index_path.c_str());
+        std::remove(bulk_path.c_str());
+        lab2_set_group_limits(1, 0, 0);
+        lab2_set_group_limits(2, 0, 0);
+        if (!ok) {
+            std::printf("%-7s ошибка\n", quotas ? "on" : "off");
+            return 1;
+        }
+
+        auto percentile = [&](double q) {
+            auto it = samples.begin() + static_cast<size_t>(q * (samples.size() - 1));
+            std::nth_element(samples.begin(), it, samples.end());
+            return *it / 1000.0;
+        };
+        uint64_t accesses = index_stats.hits + index_stats.misses;
+        std::printf("%-7s %10.1f%% %10.2f %10.2f %10llu %10llu\n", quotas ? "on" : "off",
+                    accesses > 0 ? 100.0 * index_stats.hits / accesses : 0.0, percentile(0.5), percentile(0.99),
+                    static_cast<unsigned long long>(index_stats.resident_bytes / (1024 * 1024)),
+                    static_cast<unsigned long long>(bulk_stats.resident_bytes / (1024 * 1024)));
+        std::fflush(stdout);
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        return 1;
+    }
+    if (options.huge_pages == "compare") {
+        return compare_huge_pages(options);
+    }
+    if (options.compare_groups) {
+        return compare_groups(options);
+    }
+    lab2_config config{options.cache_bytes, BLOCK, options.huge_pages == "on"};
+    if (lab2_init(&config) != 0) {
+        std::fprintf(stderr, "Ошибка настройки кэша (%zu МБ)\n", options.cache_bytes / (1024 * 1024));
+        return 1;
+    }
+    lab2_set_victim_tier(options.victim_bytes);
+    FILE* csv = nullptr;
+    if (!options.csv.empty()) {
+        csv = options.csv == "-" ? stdout : std::fopen(options.csv.c_str(), "w");
+        if (csv == nullptr) {
+            std::fprintf(stderr, "Ошибка открытия %s\n", options.csv.c_str());
+            return 1;
+        }
+        std::fprintf(csv, "workload,target,threads,file_mb,read_ratio,ops,seconds,ops_per_sec,mb_per_sec,p50_us,p99_us,hit_rate,victim_hit_rate\n");
+    }
+
+    std::vector<std::unique_ptr<Target>> all_targets;
+    all_targets.push_back(std::make_unique<CacheTarget>());
+    all_targets.push_back(std::make_unique<PosixTarget>(false));
+    all_targets.push_back(std::make_unique<PosixTarget>(true));
+    std::vector<std::unique_ptr<Target>> targets;
+    for (auto& target : all_targets) {
+        if (options.targets.find(target->name()) != std::string::npos) {
+            targets.push_back(std::move(target));
+        }
+    }
+
+    std::printf("%-12s %-7s %4s %7s %11s %9s %10s %10s %6s\n", "workload", "target", "thr", "file", "ops/s", "MB/s",
+                "p50, us", "p99, us", "hit");
+    for (const Workload& workload : make_workloads(options.cache_bytes)) {
+        if (!options.only.empty() && workload.name.find(options.only) == std::string::npos) {
+            continue;
+        }
+        std::unique_ptr<ZipfBlocks> zipf;
+        if (workload.pattern == Pattern::ZIPF) {
+            zipf = std::make_unique<ZipfBlocks>(workload.file_bytes / BLOCK);
+        }
+        for (auto& target : targets) {
+            RunResult result = run_workload(*target, workload, options, zipf.get());
+            if (!result.ok) {
+                std::printf("%-12s %-7s ошибка\n", workload.name.c_str(), target->name());
+                continue;
+            }
+            double ops_per_sec = result.ops / result.seconds;
+            double mb_per_sec = ops_per_sec * BLOCK / (1024.0 * 1024.0);
+            size_t file_mb = workload.file_bytes / (1024 * 1024);
+            char hit[32] = "-";
+            if (result.hit_rate >= 0 && options.victim_bytes > 0) {
+                // попадания в кадры + в ярус вытесненных блоков
+                std::snprintf(hit, sizeof(hit), "%.1f%%+%.1f%%", result.hit_rate * 100, result.victim_rate * 100);
+            } else if (result.hit_rate >= 0) {
+                std::snprintf(hit, sizeof(hit), "%.1f%%", result.hit_rate * 100);
+            }
+            std::printf("%-12s %-7s %4u %4zu MB %11.0f %9.1f %10.1f %10.1f %6s\n", workload.name.c_str(),
+                        target->name(), workload.threads, file_mb, ops_per_sec, mb_per_sec, result.p50_us,
+                        result.p99_us, hit);
+            std::fflush(stdout);
+            if (csv != nullptr) {
+                std::fprintf(csv, "%s,%s,%u,%zu,%.2f,%llu,%.6f,%.0f,%.2f,%.2f,%.2f,", workload.name.c_str(),
+                             target->name(), workload.threads, file_mb, workload.read_ratio,
+                             static_cast<unsigned long long>(result.ops), result.seconds, ops_per_sec, mb_per_sec,
+                             result.p50_us, result.p99_us);
+                if (result.hit_rate >= 0) {
+                    std::fprintf(csv, "%.4f,%.4f", result.hit_rate, result.victim_rate);
+                } else {
+                    std::fprintf(csv, ",");
+                }
+                std::fprintf(csv, "\n");
+                std::fflush(csv);
+            }
+        }
+    }
+    if (csv != nullptr && csv != stdout) {
+        std::fclose(csv);
+    }
+    return 0;
+}
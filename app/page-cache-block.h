@@ -0,0 +1,170 @@
+//
+// Блок кэша и связанные с ним типы, общие для page-cache.cpp и политик вытеснения.
+//
+
+#ifndef PAGE_CACHE_BLOCK_H
+#define PAGE_CACHE_BLOCK_H
+
+#include "page-cache-io.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <utility>
+#include <vector>
+
+constexpr size_t MIN_BLOCK_SIZE = 4096;   // Допустимые размеры блока (lab2_init)
+constexpr size_t MAX_BLOCK_SIZE = 65536;
+constexpr size_t MIN_SECTOR_SIZE = 512;   // Наименьшая единица учёта секторов
+
+// Битовая маска секторов блока: бит i — байты [i * sector_unit, (i + 1) * sector_unit)
+using SectorMask = uint64_t;
+constexpr size_t MAX_BLOCK_SECTORS = 64;
+
+// Геометрия кэша. Меняется только в lab2_init, пока не открыт ни один файл и кэш пуст,
+// поэтому читается без синхронизации
+inline size_t block_size = 4096;        // Размер блока, степень двойки
+inline unsigned block_shift = 12;       // log2(block_size)
+inline size_t sector_unit = 512;        // Единица учёта изменённых и актуальных данных внутри блока:
+                                        // block_size / 64, но не меньше MIN_SECTOR_SIZE
+inline SectorMask all_sectors = 0xff;   // Маска всех секторов блока
+
+// Установка размера блока (степень двойки от MIN_BLOCK_SIZE до MAX_BLOCK_SIZE)
+inline void set_block_geometry(size_t size) {
+    block_size = size;
+    block_shift = std::countr_zero(size);
+    sector_unit = std::max(MIN_SECTOR_SIZE, size / MAX_BLOCK_SECTORS);
+    size_t sectors = size / sector_unit;
+    all_sectors = sectors == MAX_BLOCK_SECTORS ? ~SectorMask{0} : (SectorMask{1} << sectors) - 1;
+}
+
+// Номер блока и начало блока, содержащего смещение offset
+inline uint64_t offset_to_block(off_t offset) {
+    return static_cast<uint64_t>(offset) >> block_shift;
+}
+
+inline off_t block_start(off_t offset) {
+    return offset & ~static_cast<off_t>(block_size - 1);
+}
+
+// Секторы, которые задевает диапазон байт [from, to) внутри блока
+inline SectorMask sector_span(size_t from, size_t to) {
+    size_t first = from / sector_unit;
+    size_t last = (to + sector_unit - 1) / sector_unit;
+    SectorMask upto = last == 64 ? ~SectorMask{0} : (SectorMask{1} << last) - 1;
+    return upto & ~((SectorMask{1} << first) - 1);
+}
+
+// Обход серий подряд идущих секторов маски: fn(первый сектор, число секторов)
+template <typename Fn>
+void for_each_sector_run(SectorMask mask, Fn fn) {
+    size_t sector = 0;
+    while (mask != 0) {
+        size_t skip = std::countr_zero(mask);
+        sector += skip;
+        mask >>= skip;
+        size_t run = std::countr_one(mask);
+        fn(sector, run);
+        sector += run;
+        mask = run == 64 ? 0 : mask >> run;
+    }
+}
+
+// Аллокатор с выравниванием по размеру блока: прямой ввод-вывод (O_DIRECT / FILE_FLAG_NO_BUFFERING)
+// требует выровненных буферов
+template <typename T>
+struct AlignedAllocator {
+    using value_type = T;
+
+    AlignedAllocator() = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        void* ptr = io_alloc_aligned(n * sizeof(T), block_size);
+        if (ptr == nullptr) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(ptr);
+    }
+
+    void deallocate(T* ptr, size_t) {
+        io_free_aligned(ptr);
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U>&) const { return true; }
+};
+
+using BlockData = std::vector<char, AlignedAllocator<char>>;
+
+// Состояние блока кэша
+enum BlockState : uint8_t {
+    BLOCK_READY,     // данные актуальны
+    BLOCK_LOADING,   // идёт чтение с диска, обращения ждут его окончания
+    BLOCK_EVICTING,  // жертва сбрасывается на диск перед удалением, обращения ждут
+};
+
+// Метаданные блока кэша. Сами блоки живут в арене (см. page-cache-arena.h),
+// свободный блок лежит в списке свободных блоков своего шарда (через policy_next)
+struct CacheBlock {
+    int fd = -1;             // Дескриптор файла
+    off_t offset = 0;        // Смещение блока в файле
+    char* data = nullptr;    // Кадр арены (block_size байт), выровнен по block_size
+    SectorMask dirty_sectors = 0;  // Изменённые секторы; блок грязный, если маска не пуста
+    SectorMask valid_sectors = 0;  // Секторы с актуальными данными (остальные ещё не читались с диска)
+    uint32_t dirty_since = 0;  // Когда блок стал грязным (мс, см. now_ms в page-cache.cpp)
+    bool prefetched = false; // Загружен упреждающим чтением, обращений ещё не было
+    BlockState state = BLOCK_READY;
+    uint32_t pins = 0;       // Незавершённые операции над блоком; закреплённый блок не вытесняется
+    uint16_t page_refs = 0;     // Страница выдана пользователю (lab2_get_page), блок не вытесняется
+    uint16_t page_writers = 0;  // Из них выданы на запись (lab2_get_page_writable)
+    uint8_t group = 0;       // Группа файла, за которой учитывается блок (lab2_set_file_group)
+
+    // Служебные поля политики вытеснения (см. page-cache-policy.h)
+    CacheBlock* policy_prev = nullptr;  // соседи в очереди политики (интрузивный список)
+    CacheBlock* policy_next = nullptr;
+    uint8_t policy_queue = 0;           // в какой очереди политики находится блок
+    uint8_t policy_bits = 0;            // бит обращения (CLOCK) / счётчик частоты (S3-FIFO)
+
+    // Соседи в списке блоков файла в шарде (см. FileBlocks в page-cache.cpp)
+    CacheBlock* file_prev = nullptr;
+    CacheBlock* file_next = nullptr;
+};
+
+// Ключ блока: (fd, offset)
+using BlockKey = std::pair<int, off_t>;
+
+// Блок можно вытеснить, если он не закреплён и не выдан пользователю
+inline bool block_evictable(const CacheBlock* block) {
+    return block->pins == 0 && block->page_refs == 0;
+}
+
+inline BlockKey block_key(const CacheBlock* block) {
+    return std::make_pair(block->fd, block->offset);
+}
+
+// Хэш ключа блока по дескриптору и номеру блока. XOR хэшей fd и offset давал одинаковые
+// значения для разных пар, поэтому ключ перемешивается финализатором splitmix64
+inline uint64_t block_key_hash(int fd, uint64_t block_no) {
+    uint64_t x = (static_cast<uint64_t>(static_cast<uint32_t>(fd)) << 40) ^ block_no;
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+// Хэш-функция для пары (fd, offset)
+struct PairHash {
+    // метод-оператор, вызывается по умолчанию для объекта при использовании его как функции
+    // функтор (функциональный объект)
+    size_t operator()(const std::pair<int, off_t>& p) const {
+        return block_key_hash(p.first, offset_to_block(p.second));
+    }
+};
+
+#endif // PAGE_CACHE_BLOCK_H
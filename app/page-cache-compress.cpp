@@ -0,0 +1,217 @@
+//
+// Реализация сжатия блоков (см. page-cache-compress.h).
+//
+
+#include "page-cache-compress.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace {
+
+constexpr size_t MIN_MATCH = 4;
+constexpr unsigned HASH_BITS = 12;  // Таблица позиций 16 КБ на стеке
+constexpr size_t MAX_OFFSET = 65535;
+
+uint32_t read32(const char* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+uint64_t read64(const char* p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// Длина общего префикса a и b не дальше limit байт от a, сравнение по 8 байт
+size_t common_length(const char* a, const char* b, size_t limit) {
+    size_t length = 0;
+    while (length + 8 <= limit) {
+        uint64_t diff = read64(a + length) ^ read64(b + length);
+        if (diff != 0) {
+            return length + (std::endian::native == std::endian::little ? std::countr_zero(diff)
+                                                                          : std::countl_zero(diff)) / 8;
+        }
+        length += 8;
+    }
+    while (length < limit && a[length] == b[length]) {
+        length++;
+    }
+    return length;
+}
+
+uint32_t hash4(uint32_t value) {
+    return (value * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// Запись сжатых данных с проверкой ёмкости
+class Output {
+public:
+    Output(char* out, size_t capacity) : out(out), capacity(capacity) {}
+
+    bool byte(uint8_t value) {
+        if (pos >= capacity) {
+            return false;
+        }
+        out[pos++] = static_cast<char>(value);
+        return true;
+    }
+
+    bool bytes(const char* data, size_t size) {
+        if (size > capacity - pos) {
+            return false;
+        }
+        memcpy(out + pos, data, size);
+        pos += size;
+        return true;
+    }
+
+    // Продолжение длины после 15 в токене
+    bool length(size_t value) {
+        for (; value >= 255; value -= 255) {
+            if (!byte(255)) {
+                return false;
+            }
+        }
+        return byte(static_cast<uint8_t>(value));
+    }
+
+    size_t size() const { return pos; }
+
+private:
+    char* out;
+    size_t capacity;
+    size_t pos = 0;
+};
+
+// Последовательность: literals литералов с literal, затем совпадение длины match (0 — последняя)
+bool put_sequence(Output& output, const char* literal, size_t literals, size_t offset, size_t match) {
+    size_t match_code = match != 0 ? match - MIN_MATCH : 0;
+    uint8_t token = static_cast<uint8_t>((literals < 15 ? literals : 15) << 4 | (match_code < 15 ? match_code : 15));
+    if (!output.byte(token) || (literals >= 15 && !output.length(literals - 15)) ||
+        !output.bytes(literal, literals)) {
+        return false;
+    }
+    if (match == 0) {
+        return true;
+    }
+    return output.byte(static_cast<uint8_t>(offset)) && output.byte(static_cast<uint8_t>(offset >> 8)) &&
+           (match_code < 15 || output.length(match_code - 15));
+}
+
+// Чтение продолжения длины
+bool get_length(const uint8_t*& ip, const uint8_t* end, size_t& value) {
+    uint8_t byte;
+    do {
+        if (ip >= end) {
+            return false;
+        }
+        byte = *ip++;
+        value += byte;
+    } while (byte == 255);
+    return true;
+}
+
+} // namespace
+
+bool block_pattern(const char* data, size_t size, uint8_t* pattern) {
+    if (size == 0 || memcmp(data, data + 1, size - 1) != 0) {
+        return false;
+    }
+    *pattern = static_cast<uint8_t>(data[0]);
+    return true;
+}
+
+size_t lz_compress(const char* data, size_t size, char* out, size_t capacity) {
+    uint32_t table[1u << HASH_BITS] = {};
+    Output output(out, capacity);
+    size_t anchor = 0;  // начало ещё не записанных литералов
+    size_t pos = 0;
+    while (pos + MIN_MATCH <= size) {
+        uint32_t value = read32(data + pos);
+        uint32_t& slot = table[hash4(value)];
+        size_t candidate = slot;
+        slot = static_cast<uint32_t>(pos);
+        if (candidate >= pos || pos - candidate > MAX_OFFSET || read32(data + candidate) != value) {
+            // в несжимаемых данных шаг растёт, чтобы не тратить время на каждый байт
+            pos += 1 + ((pos - anchor) >> 6);
+            continue;
+        }
+        size_t match = MIN_MATCH + common_length(data + pos + MIN_MATCH, data + candidate + MIN_MATCH,
+                                                 size - pos - MIN_MATCH);
+        if (!put_sequence(output, data + anchor, pos - anchor, pos - candidate, match)) {
+            return 0;
+        }
+        pos += match;
+        anchor = pos;
+        if (pos >= 2 && pos + MIN_MATCH <= size) {
+            table[hash4(read32(data + pos - 2))] = static_cast<uint32_t>(pos - 2);
+        }
+    }
+    if (!put_sequence(output, data + anchor, size - anchor, 0, 0)) {
+        return 0;
+    }
+    return output.size();
+}
+
+bool lz_decompress(const char* data, size_t size, char* out, size_t out_size) {
+    auto ip = reinterpret_cast<const uint8_t*>(data);
+    const uint8_t* end = ip + size;
+    size_t op = 0;
+    while (ip < end) {
+        uint8_t token = *ip++;
+        size_t literals = token >> 4;
+        if (literals == 15 && !get_length(ip, end, literals)) {
+            return false;
+        }
+        size_t in_left = static_cast<size_t>(end - ip);
+        if (literals > in_left || literals > out_size - op) {
+            return false;
+        }
+        if (literals <= 16 && in_left >= 16 && out_size - op >= 16) {
+            memcpy(out + op, ip, 16);  // копия фиксированной длины быстрее; лишнее перезапишется
+        } else {
+            memcpy(out + op, ip, literals);
+        }
+        ip += literals;
+        op += literals;
+        if (ip == end) {
+            break;  // последняя последовательность
+        }
+
+        if (end - ip < 2) {
+            return false;
+        }
+        size_t offset = ip[0] | static_cast<size_t>(ip[1]) << 8;
+        ip += 2;
+        size_t match = token & 15;
+        if (match == 15 && !get_length(ip, end, match)) {
+            return false;
+        }
+        match += MIN_MATCH;
+        if (offset == 0 || offset > op || match > out_size - op) {
+            return false;
+        }
+        // совпадение может перекрываться с собой (повтор короткого фрагмента): копируем
+        // порциями не длиннее смещения, тогда источник каждой порции уже записан
+        size_t match_end = op + match;
+        if (offset >= 16) {
+            // порциями по 16 байт, последняя может выйти за совпадение, но не за out
+            for (; op < match_end && out_size - op >= 16; op += 16) {
+                memcpy(out + op, out + op - offset, 16);
+            }
+            op = std::min(op, match_end);
+        } else if (offset >= 8) {
+            for (; op + 8 <= match_end; op += 8) {
+                memcpy(out + op, out + op - offset, 8);
+            }
+        }
+        for (; op < match_end; ++op) {
+            out[op] = out[op - offset];
+        }
+    }
+    return op == out_size;
+}
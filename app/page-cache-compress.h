@@ -0,0 +1,28 @@
+//
+// Сжатие блоков для яруса вытесненных блоков (см. page-cache-victim.h): быстрый LZ77
+// в духе LZ4 и распознавание блоков из одного повторённого байта.
+//
+// Формат сжатых данных — последовательности LZ4: токен (длина литералов в старших 4 битах,
+// длина совпадения минус 4 — в младших; 15 означает продолжение байтами по 255), литералы,
+// 2 байта смещения совпадения (little-endian), продолжение длины совпадения. Последняя
+// последовательность состоит только из литералов. Окно — 64 КБ, то есть весь блок.
+//
+
+#ifndef PAGE_CACHE_COMPRESS_H
+#define PAGE_CACHE_COMPRESS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Все байты data одинаковы; сам байт — в *pattern
+bool block_pattern(const char* data, size_t size, uint8_t* pattern);
+
+// Сжатие size байт (не больше 64 КБ) в out ёмкостью capacity.
+// Возвращает длину сжатых данных или 0, если они не поместились в capacity
+size_t lz_compress(const char* data, size_t size, char* out, size_t capacity);
+
+// Распаковка size байт сжатых данных ровно в out_size байт out.
+// Возвращает false, если данные повреждены
+bool lz_decompress(const char* data, size_t size, char* out, size_t out_size);
+
+#endif // PAGE_CACHE_COMPRESS_H
@@ -0,0 +1,129 @@
+//
+// Микробенчмарк индекса блоков: BlockIndex против прежнего
+// std::unordered_map<std::pair<int, off_t>, CacheBlock*, PairHash> с XOR-хэшем.
+// Индекс заполняется до полной ёмкости кэша (и до ёмкости одного шарда), затем
+// измеряются поиск присутствующих и отсутствующих ключей и замена ключа (erase + insert),
+// как при вытеснении блока.
+//
+
+#include "page-cache-block.h"
+#include "page-cache-index.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#define CACHE_CAPACITY (1024 * 25)  // Ёмкость кэша по умолчанию (блоков по 4 КБ)
+#define SHARD_COUNT 16
+#define FILE_COUNT 8    // Ключи распределены по нескольким файлам, как в app.cpp
+#define OPS 2000000
+
+// Хэш, которым пользовался blocks_map до BlockIndex
+struct XorPairHash {
+    size_t operator()(const std::pair<int, off_t>& p) const {
+        return std::hash<int>()(p.first) ^ std::hash<off_t>()(p.second);
+    }
+};
+
+using OldMap = std::unordered_map<std::pair<int, off_t>, CacheBlock*, XorPairHash>;
+
+// Адаптер к общему интерфейсу замеров
+struct OldIndex {
+    OldMap map;
+    explicit OldIndex(size_t capacity) { map.reserve(capacity); }
+    CacheBlock* find(const BlockKey& key) const {
+        auto it = map.find(key);
+        return it == map.end() ? nullptr : it->second;
+    }
+    void insert(const BlockKey& key, CacheBlock* block) { map.emplace(key, block); }
+    void erase(const BlockKey& key) { map.erase(key); }
+};
+
+struct NewIndex {
+    BlockIndex index;
+    explicit NewIndex(size_t capacity) : index(capacity) {}
+    CacheBlock* find(const BlockKey& key) const { return index.find(key); }
+    void insert(const BlockKey& key, CacheBlock* block) { index.insert(key, block); }
+    void erase(const BlockKey& key) { index.erase(key); }
+};
+
+// Ключи: файлы по очереди, в каждом — подряд идущие блоки (дескрипторы 3, 4, ...)
+static std::vector<BlockKey> make_keys(size_t count, size_t first_block) {
+    std::vector<BlockKey> keys;
+    keys.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        int fd = 3 + static_cast<int>(i % FILE_COUNT);
+        off_t offset = static_cast<off_t>(first_block + i / FILE_COUNT) * block_size;
+        keys.emplace_back(fd, offset);
+    }
+    return keys;
+}
+
+static double ns_per_op(std::chrono::steady_clock::time_point start, size_t ops) {
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / ops;
+}
+
+template <typename Index>
+static void run(const char* name, size_t capacity) {
+    std::vector<CacheBlock> blocks(capacity * 2);
+    std::vector<BlockKey> present = make_keys(capacity, 0);
+    std::vector<BlockKey> absent = make_keys(capacity, capacity);  // блоки за пределами кэша
+    Index index(capacity);
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < capacity; ++i) {
+        index.insert(present[i], &blocks[i]);
+    }
+    double fill = ns_per_op(start, capacity);
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<size_t> pick(0, capacity - 1);
+    std::vector<size_t> order(OPS);
+    for (size_t& i : order) {
+        i = pick(rng);
+    }
+
+    size_t found = 0;
+    start = std::chrono::steady_clock::now();
+    for (size_t i : order) {
+        found += index.find(present[i]) != nullptr;
+    }
+    double hit = ns_per_op(start, OPS);
+
+    start = std::chrono::steady_clock::now();
+    for (size_t i : order) {
+        found += index.find(absent[i]) != nullptr;
+    }
+    double miss = ns_per_op(start, OPS);
+
+    // Замена: ключ present[i] вытесняется, на его место приходит absent[i], и обратно
+    std::vector<bool> swapped(capacity);
+    start = std::chrono::steady_clock::now();
+    for (size_t i : order) {
+        const BlockKey& from = swapped[i] ? absent[i] : present[i];
+        const BlockKey& to = swapped[i] ? present[i] : absent[i];
+        index.erase(from);
+        index.insert(to, &blocks[i]);
+        swapped[i] = !swapped[i];
+    }
+    double churn = ns_per_op(start, OPS);
+
+    if (found != OPS) {
+        std::printf("%s: неверный результат поиска (%zu)\n", name, found);
+        std::exit(1);
+    }
+    std::printf("%-14s %8zu %10.1f %10.1f %10.1f %14.1f\n", name, capacity, fill, hit, miss, churn);
+}
+
+int main() {
+    std::printf("%-14s %8s %10s %10s %10s %14s\n", "index", "blocks", "insert ns", "hit ns", "miss ns", "erase+ins ns");
+    for (size_t capacity : {static_cast<size_t>(CACHE_CAPACITY / SHARD_COUNT), static_cast<size_t>(CACHE_CAPACITY)}) {
+        run<OldIndex>("unordered_map", capacity);
+        run<NewIndex>("BlockIndex", capacity);
+    }
+    return 0;
+}
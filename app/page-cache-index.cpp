@@ -0,0 +1,105 @@
+//
+// Индекс блоков шарда (см. page-cache-index.h).
+//
+
+#include "page-cache-index.h"
+
+#include <utility>
+
+// Максимальная заполненность таблицы: 1/2. При большей заполненности цепочки удлиняются,
+// и поиск в случайном порядке упирается в неверно предсказанные переходы; слот весит
+// 24 байта, так что запас стоит около 1% от размера кадров
+static size_t max_load(size_t slot_count) {
+    return slot_count / 2;
+}
+
+BlockIndex::BlockIndex(size_t capacity) {
+    size_t slot_count = 16;
+    while (max_load(slot_count) < capacity) {
+        slot_count *= 2;
+    }
+    slots.resize(slot_count);
+    mask = slot_count - 1;
+}
+
+size_t BlockIndex::home(uint64_t block_no, int32_t fd) const {
+    return block_key_hash(fd, block_no) & mask;
+}
+
+CacheBlock* BlockIndex::find(const BlockKey& key) const {
+    uint64_t block_no = offset_to_block(key.second);
+    size_t pos = home(block_no, key.first);
+    for (uint32_t distance = 0;; ++distance, pos = (pos + 1) & mask) {
+        const Slot& slot = slots[pos];
+        // у ключа, лежащего дальше, расстояние было бы не меньше, чем у встреченного соседа
+        if (slot.block == nullptr || slot.distance < distance) {
+            return nullptr;
+        }
+        if (slot.block_no == block_no && slot.fd == key.first) {
+            return slot.block;
+        }
+    }
+}
+
+// Вставка слота, ключа которого в таблице нет. Места гарантированно хватает
+void BlockIndex::place(Slot slot) {
+    size_t pos = home(slot.block_no, slot.fd);
+    slot.distance = 0;
+    for (;; pos = (pos + 1) & mask, ++slot.distance) {
+        Slot& current = slots[pos];
+        if (current.block == nullptr) {
+            current = slot;
+            return;
+        }
+        if (current.distance < slot.distance) {
+            // Robin Hood: «богатый» элемент уступает место и продолжает поиск сам
+            std::swap(current, slot);
+        }
+    }
+}
+
+void BlockIndex::grow() {
+    std::vector<Slot> old = std::move(slots);
+    slots.assign(old.size() * 2, Slot{});
+    mask = slots.size() - 1;
+    for (const Slot& slot : old) {
+        if (slot.block != nullptr) {
+            place(slot);
+        }
+    }
+}
+
+void BlockIndex::insert(const BlockKey& key, CacheBlock* block) {
+    if (count + 1 > max_load(slots.size())) {
+        grow();
+    }
+    place(Slot{offset_to_block(key.second), key.first, 0, block});
+    count++;
+}
+
+bool BlockIndex::erase(const BlockKey& key) {
+    uint64_t block_no = offset_to_block(key.second);
+    size_t pos = home(block_no, key.first);
+    for (uint32_t distance = 0;; ++distance, pos = (pos + 1) & mask) {
+        const Slot& slot = slots[pos];
+        if (slot.block == nullptr || slot.distance < distance) {
+            return false;
+        }
+        if (slot.block_no == block_no && slot.fd == key.first) {
+            break;
+        }
+    }
+    // сдвиг следующих элементов цепочки на одну позицию назад
+    for (;;) {
+        size_t next = (pos + 1) & mask;
+        if (slots[next].block == nullptr || slots[next].distance == 0) {
+            break;
+        }
+        slots[pos] = slots[next];
+        slots[pos].distance--;
+        pos = next;
+    }
+    slots[pos] = Slot{};
+    count--;
+    return true;
+}
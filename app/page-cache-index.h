@@ -0,0 +1,63 @@
+//
+// Индекс блоков шарда: ключ (fd, offset) -> CacheBlock*.
+// Плоская хэш-таблица с открытой адресацией и упорядочиванием Robin Hood: элемент, ушедший
+// дальше от своей позиции, вытесняет более «близкий», поэтому поиск отсутствующего ключа
+// останавливается рано, а удаление сдвигает хвост цепочки назад без надгробий.
+// Ключ хранится прямо в слоте (дескриптор и номер блока), сравнение не трогает CacheBlock.
+//
+
+#ifndef PAGE_CACHE_INDEX_H
+#define PAGE_CACHE_INDEX_H
+
+#include "page-cache-block.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class BlockIndex {
+public:
+    // capacity — ожидаемое число блоков; таблица заранее выделяется под него
+    explicit BlockIndex(size_t capacity = 0);
+
+    // Блок по ключу или nullptr
+    CacheBlock* find(const BlockKey& key) const;
+    bool contains(const BlockKey& key) const { return find(key) != nullptr; }
+
+    // Добавление блока; ключа в индексе быть не должно
+    void insert(const BlockKey& key, CacheBlock* block);
+
+    // Удаление ключа. Возвращает false, если ключа не было
+    bool erase(const BlockKey& key);
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    // Обход всех блоков индекса. f не должна менять индекс
+    template <typename F>
+    void for_each(F&& f) const {
+        for (const Slot& slot : slots) {
+            if (slot.block != nullptr) {
+                f(slot.block);
+            }
+        }
+    }
+
+private:
+    struct Slot {
+        uint64_t block_no;           // offset_to_block(offset)
+        int32_t fd;
+        uint32_t distance;           // расстояние от домашней позиции ключа
+        CacheBlock* block = nullptr; // nullptr — слот свободен
+    };
+
+    size_t home(uint64_t block_no, int32_t fd) const;
+    void place(Slot slot);
+    void grow();
+
+    std::vector<Slot> slots;  // размер — степень двойки
+    size_t mask = 0;
+    size_t count = 0;
+};
+
+#endif // PAGE_CACHE_INDEX_H
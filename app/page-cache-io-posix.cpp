@@ -0,0 +1,279 @@
+//
+// POSIX-бэкенд ввода-вывода: O_DIRECT (аналог FILE_FLAG_NO_BUFFERING) и позиционные pread/pwrite.
+//
+
+#include "page-cache-io.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <climits>
+#include <cstdint>
+#include <cerrno>
+#include <cstdlib>
+#include <algorithm>
+
+// Открытие файла
+bool io_open(const char *path, IoOpenMode mode, io_handle_t *handle) {
+    // O_DSYNC — как FILE_FLAG_WRITE_THROUGH
+    int flags = O_RDWR | O_DSYNC;
+    switch (mode) {
+        case IO_CREATE_NEW:
+            flags |= O_CREAT | O_EXCL;
+            break;
+        case IO_CREATE_ALWAYS:
+            flags |= O_CREAT | O_TRUNC;
+            break;
+        case IO_OPEN_EXISTING:
+            break;
+        case IO_OPEN_ALWAYS:
+            flags |= O_CREAT;
+            break;
+        case IO_TRUNCATE_EXISTING:
+            flags |= O_TRUNC;
+            break;
+    }
+#ifdef O_DIRECT
+    int fd = open(path, flags | O_DIRECT, 0644);
+    // Некоторые ФС (например, tmpfs) не поддерживают O_DIRECT — работаем через кэш ОС
+    if (fd == -1 && errno == EINVAL) {
+        fd = open(path, flags, 0644);
+    }
+#else
+    int fd = open(path, flags, 0644);
+#endif
+    if (fd == -1) {
+        return false;
+    }
+    *handle = fd;
+    return true;
+}
+
+// Закрытие файла
+int io_close(io_handle_t handle) {
+    return close(handle) == 0 ? 0 : -1;
+}
+
+// Позиционное чтение. Повторяем при прерывании сигналом и коротком чтении до конца файла
+ssize_t io_pread(io_handle_t handle, void *buf, size_t count, off_t offset) {
+    size_t done = 0;
+    while (done < count) {
+        ssize_t n = pread(handle, static_cast<char*>(buf) + done, count - done, offset + done);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (n == 0) {
+            break; // конец файла
+        }
+        done += n;
+    }
+    return done;
+}
+
+// Позиционная запись
+ssize_t io_pwrite(io_handle_t handle, const void *buf, size_t count, off_t offset) {
+    size_t done = 0;
+    while (done < count) {
+        ssize_t n = pwrite(handle, static_cast<const char*>(buf) + done, count - done, offset + done);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (n == 0) {
+            // устройство ничего не записало: короткая запись, а не повтор до бесконечности
+            if (done > 0) {
+                break;
+            }
+            errno = EIO;
+            return -1;
+        }
+        done += n;
+    }
+    return done;
+}
+
+// Векторное позиционное чтение. Короткое чтение продолжается с места остановки
+ssize_t io_preadv(io_handle_t handle, const IoVec *iov, int iovcnt, off_t offset) {
+    struct iovec vecs[IO_MAX_IOV];
+    iovcnt = std::min(iovcnt, std::min(IO_MAX_IOV, static_cast<int>(IOV_MAX)));
+    for (int i = 0; i < iovcnt; ++i) {
+        vecs[i].iov_base = iov[i].base;
+        vecs[i].iov_len = iov[i].len;
+    }
+
+    size_t done = 0;
+    int first = 0;
+    while (first < iovcnt) {
+        ssize_t n = preadv(handle, vecs + first, iovcnt - first, offset + done);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (n == 0) {
+            break; // конец файла
+        }
+        done += n;
+        // пропускаем заполненные буферы, у частично заполненного сдвигаем начало
+        while (first < iovcnt && static_cast<size_t>(n) >= vecs[first].iov_len) {
+            n -= vecs[first].iov_len;
+            first++;
+        }
+        if (first < iovcnt) {
+            vecs[first].iov_base = static_cast<char*>(vecs[first].iov_base) + n;
+            vecs[first].iov_len -= n;
+        }
+    }
+    return done;
+}
+
+// Векторная позиционная запись. Короткая запись продолжается с места остановки
+ssize_t io_pwritev(io_handle_t handle, const IoVec *iov, int iovcnt, off_t offset) {
+    struct iovec vecs[IO_MAX_IOV];
+    iovcnt = std::min(iovcnt, std::min(IO_MAX_IOV, static_cast<int>(IOV_MAX)));
+    for (int i = 0; i < iovcnt; ++i) {
+        vecs[i].iov_base = iov[i].base;
+        vecs[i].iov_len = iov[i].len;
+    }
+
+    size_t done = 0;
+    int first = 0;
+    while (first < iovcnt) {
+        ssize_t n = pwritev(handle, vecs + first, iovcnt - first, offset + done);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return done > 0 ? static_cast<ssize_t>(done) : -1;
+        }
+        if (n == 0) {
+            // короткая запись, как в io_pwrite
+            if (done > 0) {
+                break;
+            }
+            errno = EIO;
+            return -1;
+        }
+        done += n;
+        while (first < iovcnt && static_cast<size_t>(n) >= vecs[first].iov_len) {
+            n -= vecs[first].iov_len;
+            first++;
+        }
+        if (first < iovcnt) {
+            vecs[first].iov_base = static_cast<char*>(vecs[first].iov_base) + n;
+            vecs[first].iov_len -= n;
+        }
+    }
+    return done;
+}
+
+// Выравнивание прямого ввода-вывода. statx сообщает его с Linux 6.1; на файлах,
+// открытых без O_DIRECT (см. io_open), оно равно 0 и подходит любое
+size_t io_sector_size(io_handle_t handle) {
+#ifdef STATX_DIOALIGN
+    struct statx stx;
+    if (statx(handle, "", AT_EMPTY_PATH, STATX_DIOALIGN, &stx) == 0 && (stx.stx_mask & STATX_DIOALIGN) &&
+        stx.stx_dio_offset_align > 0) {
+        return stx.stx_dio_offset_align;
+    }
+#endif
+    return 512;
+}
+
+// Перемещение указателя файла
+off_t io_seek(io_handle_t handle, off_t offset, int whence) {
+    return lseek(handle, offset, whence);
+}
+
+// Изменение размера файла
+int io_truncate(io_handle_t handle, off_t size) {
+    while (ftruncate(handle, size) == -1) {
+        if (errno != EINTR) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+bool io_file_id(io_handle_t handle, uint64_t *device, uint64_t *inode) {
+    struct stat st;
+    if (fstat(handle, &st) != 0) {
+        return false;
+    }
+    *device = static_cast<uint64_t>(st.st_dev);
+    *inode = static_cast<uint64_t>(st.st_ino);
+    return true;
+}
+
+int io_handle_to_fd(io_handle_t handle) {
+    return handle;
+}
+
+void *io_alloc_aligned(size_t size, size_t alignment) {
+    void *ptr = nullptr;
+    if (posix_memalign(&ptr, alignment, size) != 0) {
+        return nullptr;
+    }
+    return ptr;
+}
+
+void io_free_aligned(void *ptr) {
+    free(ptr);
+}
+
+// Размер области с большими страницами: кратен IO_HUGE_PAGE_SIZE
+static size_t huge_span(size_t size) {
+    return (size + IO_HUGE_PAGE_SIZE - 1) / IO_HUGE_PAGE_SIZE * IO_HUGE_PAGE_SIZE;
+}
+
+void *io_alloc_frames(size_t size, size_t alignment, bool huge, FrameBacking *backing) {
+    if (huge) {
+        size_t span = huge_span(size);
+#ifdef MAP_HUGETLB
+        // явные страницы есть, только если администратор зарезервировал их (vm.nr_hugepages)
+        void *ptr = mmap(nullptr, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (ptr != MAP_FAILED) {
+            *backing = FRAMES_HUGE;
+            return ptr;
+        }
+#endif
+        // область с запасом, чтобы вырезать из неё кусок, выровненный по большой странице
+        char *raw = static_cast<char *>(mmap(nullptr, span + IO_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+        if (raw != MAP_FAILED) {
+            uintptr_t address = reinterpret_cast<uintptr_t>(raw);
+            char *aligned = raw + (IO_HUGE_PAGE_SIZE - address % IO_HUGE_PAGE_SIZE) % IO_HUGE_PAGE_SIZE;
+            if (aligned != raw) {
+                munmap(raw, aligned - raw);
+            }
+            munmap(aligned + span, raw + span + IO_HUGE_PAGE_SIZE - (aligned + span));
+#ifdef MADV_HUGEPAGE
+            madvise(aligned, span, MADV_HUGEPAGE);
+#endif
+            *backing = FRAMES_TRANSPARENT;
+            return aligned;
+        }
+    }
+    *backing = FRAMES_REGULAR;
+    return io_alloc_aligned(size, alignment);
+}
+
+void io_free_frames(void *ptr, size_t size, FrameBacking backing) {
+    if (backing == FRAMES_REGULAR) {
+        io_free_aligned(ptr);
+    } else {
+        munmap(ptr, huge_span(size));
+    }
+}
+
+void io_discard(void *ptr, size_t size) {
+    madvise(ptr, size, MADV_DONTNEED);
+}
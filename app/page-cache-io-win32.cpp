@@ -0,0 +1,197 @@
+//
+// Win32-бэкенд ввода-вывода: CreateFileA + FILE_FLAG_NO_BUFFERING.
+//
+
+#include "page-cache-io.h"
+
+#include <windows.h>
+#include <malloc.h> // Для _aligned_malloc и _aligned_free
+
+// Открытие файла
+bool io_open(const char *path, IoOpenMode mode, io_handle_t *handle) {
+    HANDLE hFile = CreateFileA(
+        path, // путь к файлу
+        GENERIC_READ | GENERIC_WRITE, // доступ к чтению/ записи
+        0, // режим совместного доступа (тут эксклюзивный)
+        NULL, // атрибуты безопасности (тут по умолчанию)
+        mode, // значения IoOpenMode совпадают с CREATE_NEW ... TRUNCATE_EXISTING
+        FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH,  // обход кэша ОС
+        NULL // шаблон файла (тут не используется)
+    );
+    if (hFile == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    *handle = hFile;
+    return true;
+}
+
+// Закрытие файла
+int io_close(io_handle_t handle) {
+    return CloseHandle(handle) ? 0 : -1;
+}
+
+// ReadFile/WriteFile с OVERLAPPED на синхронном хэндле сдвигают указатель файла,
+// поэтому сохраняем его и восстанавливаем после операции
+static bool save_position(HANDLE hFile, LARGE_INTEGER *saved) {
+    LARGE_INTEGER zero;
+    zero.QuadPart = 0;
+    return SetFilePointerEx(hFile, zero, saved, FILE_CURRENT);
+}
+
+static void restore_position(HANDLE hFile, LARGE_INTEGER saved) {
+    SetFilePointerEx(hFile, saved, NULL, FILE_BEGIN);
+}
+
+// Позиционное чтение
+ssize_t io_pread(io_handle_t handle, void *buf, size_t count, off_t offset) {
+    LARGE_INTEGER saved;
+    if (!save_position(handle, &saved)) {
+        return -1;
+    }
+    OVERLAPPED ov = {};
+    ov.Offset = static_cast<DWORD>(static_cast<uint64_t>(offset) & 0xFFFFFFFF);
+    ov.OffsetHigh = static_cast<DWORD>(static_cast<uint64_t>(offset) >> 32);
+    DWORD bytes_read = 0;
+    BOOL ok = ReadFile(handle, buf, static_cast<DWORD>(count), &bytes_read, &ov);
+    restore_position(handle, saved);
+    if (!ok && GetLastError() != ERROR_HANDLE_EOF) {
+        return -1;
+    }
+    return bytes_read;
+}
+
+// Позиционная запись
+ssize_t io_pwrite(io_handle_t handle, const void *buf, size_t count, off_t offset) {
+    LARGE_INTEGER saved;
+    if (!save_position(handle, &saved)) {
+        return -1;
+    }
+    OVERLAPPED ov = {};
+    ov.Offset = static_cast<DWORD>(static_cast<uint64_t>(offset) & 0xFFFFFFFF);
+    ov.OffsetHigh = static_cast<DWORD>(static_cast<uint64_t>(offset) >> 32);
+    DWORD written = 0;
+    BOOL ok = WriteFile(handle, buf, static_cast<DWORD>(count), &written, &ov);
+    restore_position(handle, saved);
+    if (!ok) {
+        return -1;
+    }
+    return written;
+}
+
+// Векторное позиционное чтение. ReadFileScatter требует асинхронного хэндла,
+// поэтому буферы читаются последовательно
+ssize_t io_preadv(io_handle_t handle, const IoVec *iov, int iovcnt, off_t offset) {
+    size_t done = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+        ssize_t n = io_pread(handle, iov[i].base, iov[i].len, offset + done);
+        if (n == -1) {
+            return -1;
+        }
+        done += n;
+        if (static_cast<size_t>(n) < iov[i].len) {
+            break; // конец файла
+        }
+    }
+    return done;
+}
+
+// Векторная позиционная запись. WriteFileGather, как и ReadFileScatter, требует
+// асинхронного хэндла, поэтому буферы записываются последовательно
+ssize_t io_pwritev(io_handle_t handle, const IoVec *iov, int iovcnt, off_t offset) {
+    size_t done = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+        ssize_t n = io_pwrite(handle, iov[i].base, iov[i].len, offset + done);
+        if (n == -1) {
+            return done > 0 ? static_cast<ssize_t>(done) : -1;
+        }
+        done += n;
+    }
+    return done;
+}
+
+// Размер логического сектора тома: FILE_FLAG_NO_BUFFERING требует выравнивания по нему
+size_t io_sector_size(io_handle_t handle) {
+    FILE_STORAGE_INFO info = {};
+    if (GetFileInformationByHandleEx(handle, FileStorageInfo, &info, sizeof(info)) &&
+        info.LogicalBytesPerSector > 0) {
+        return info.LogicalBytesPerSector;
+    }
+    return 512;
+}
+
+// Перемещение указателя файла
+off_t io_seek(io_handle_t handle, off_t offset, int whence) {
+    LARGE_INTEGER new_pos;
+    new_pos.QuadPart = offset;
+    LARGE_INTEGER result_pos;
+    // SEEK_SET/SEEK_CUR/SEEK_END совпадают с FILE_BEGIN/FILE_CURRENT/FILE_END
+    if (!SetFilePointerEx(handle, new_pos, &result_pos, whence)) {
+        return -1;
+    }
+    return static_cast<off_t>(result_pos.QuadPart);
+}
+
+bool io_file_id(io_handle_t handle, uint64_t *device, uint64_t *inode) {
+    BY_HANDLE_FILE_INFORMATION info;
+    if (!GetFileInformationByHandle(handle, &info)) {
+        return false;
+    }
+    *device = info.dwVolumeSerialNumber;
+    *inode = (static_cast<uint64_t>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+    return true;
+}
+
+// Изменение размера файла: конец файла ставится в текущую позицию указателя
+int io_truncate(io_handle_t handle, off_t size) {
+    LARGE_INTEGER saved;
+    if (!save_position(handle, &saved)) {
+        return -1;
+    }
+    LARGE_INTEGER end;
+    end.QuadPart = size;
+    bool ok = SetFilePointerEx(handle, end, NULL, FILE_BEGIN) && SetEndOfFile(handle);
+    SetFilePointerEx(handle, saved, NULL, FILE_BEGIN);
+    return ok ? 0 : -1;
+}
+
+int io_handle_to_fd(io_handle_t handle) {
+    // HANDLE -> intptr_t -> int
+    return static_cast<int>(reinterpret_cast<intptr_t>(handle));
+}
+
+void *io_alloc_aligned(size_t size, size_t alignment) {
+    return _aligned_malloc(size, alignment);
+}
+
+void io_free_aligned(void *ptr) {
+    _aligned_free(ptr);
+}
+
+// Большие страницы в Windows требуют привилегии SeLockMemoryPrivilege; без неё
+// VirtualAlloc с MEM_LARGE_PAGES не удаётся, и используется обычная память.
+// Прозрачных больших страниц нет
+void *io_alloc_frames(size_t size, size_t alignment, bool huge, FrameBacking *backing) {
+    SIZE_T large = huge ? GetLargePageMinimum() : 0;
+    if (large != 0) {
+        SIZE_T span = (size + large - 1) / large * large;
+        void *ptr = VirtualAlloc(nullptr, span, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+        if (ptr != nullptr) {
+            *backing = FRAMES_HUGE;
+            return ptr;
+        }
+    }
+    *backing = FRAMES_REGULAR;
+    return io_alloc_aligned(size, alignment);
+}
+
+void io_free_frames(void *ptr, size_t size, FrameBacking backing) {
+    if (backing == FRAMES_REGULAR) {
+        io_free_aligned(ptr);
+    } else {
+        VirtualFree(ptr, 0, MEM_RELEASE);
+    }
+}
+
+void io_discard(void *ptr, size_t size) {
+    VirtualAlloc(ptr, size, MEM_RESET, PAGE_READWRITE);
+}
@@ -0,0 +1,103 @@
+//
+// Платформенный слой ввода-вывода для page-cache.
+// Реализация выбирается на этапе конфигурации (см. PAGE_CACHE_IO_BACKEND в app/CMakeLists.txt):
+//  - page-cache-io-win32.cpp — CreateFileA + FILE_FLAG_NO_BUFFERING;
+//  - page-cache-io-posix.cpp — open + O_DIRECT, pread/pwrite.
+//
+
+#ifndef PAGE_CACHE_IO_H
+#define PAGE_CACHE_IO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <sys/types.h>
+
+#ifdef _WIN32
+using io_handle_t = void*;  // HANDLE (без подключения windows.h в заголовке)
+#else
+using io_handle_t = int;    // файловый дескриптор
+#endif
+
+// Что делать с файлом при открытии (значения совпадают с dwCreationDisposition CreateFileA)
+enum IoOpenMode : uint8_t {
+    IO_CREATE_NEW = 1,        // создать; ошибка, если файл есть
+    IO_CREATE_ALWAYS = 2,     // создать или обрезать существующий до нуля
+    IO_OPEN_EXISTING = 3,     // открыть; ошибка, если файла нет
+    IO_OPEN_ALWAYS = 4,       // открыть или создать
+    IO_TRUNCATE_EXISTING = 5, // открыть и обрезать до нуля; ошибка, если файла нет
+};
+
+// Открытие файла для чтения и записи в обход кэша ОС. Возвращает false в случае ошибки
+// (errno/GetLastError — от ОС).
+bool io_open(const char *path, IoOpenMode mode, io_handle_t *handle);
+
+// Закрытие файла. Возвращает 0 в случае успеха, -1 в случае ошибки.
+int io_close(io_handle_t handle);
+
+// Позиционное чтение/запись, не меняющие позицию указателя файла.
+// buf и offset должны быть выровнены по размеру блока (требование прямого ввода-вывода).
+// Возвращают количество байт или -1 в случае ошибки.
+ssize_t io_pread(io_handle_t handle, void *buf, size_t count, off_t offset);
+ssize_t io_pwrite(io_handle_t handle, const void *buf, size_t count, off_t offset);
+
+// Элемент векторного ввода-вывода (аналог struct iovec)
+struct IoVec {
+    void *base;
+    size_t len;
+};
+
+// Максимальное число буферов в одном векторном вызове (IOV_MAX в Linux)
+constexpr int IO_MAX_IOV = 1024;
+
+// Векторное позиционное чтение в несколько буферов подряд, начиная с offset.
+// iovcnt не больше IO_MAX_IOV; требования к выравниванию те же, что у io_pread.
+// Возвращает количество прочитанных байт (меньше запрошенного — конец файла) или -1.
+ssize_t io_preadv(io_handle_t handle, const IoVec *iov, int iovcnt, off_t offset);
+
+// Векторная позиционная запись нескольких буферов подряд, начиная с offset.
+// Ограничения те же, что у io_preadv. Возвращает количество записанных байт
+// (при ошибке посреди записи — сколько успело записаться) или -1.
+ssize_t io_pwritev(io_handle_t handle, const IoVec *iov, int iovcnt, off_t offset);
+
+// Выравнивание смещений прямого ввода-вывода для файла (размер логического сектора
+// устройства, обычно 512 или 4096 байт). Если узнать не удалось — 512.
+size_t io_sector_size(io_handle_t handle);
+
+// Перемещение указателя файла. Возвращает новое смещение или -1 в случае ошибки.
+off_t io_seek(io_handle_t handle, off_t offset, int whence);
+
+// Изменение размера файла. Возвращает 0 в случае успеха, -1 в случае ошибки.
+int io_truncate(io_handle_t handle, off_t size);
+
+// Идентичность файла: устройство и номер файла на нём (st_dev/st_ino, в Windows — серийный
+// номер тома и индекс файла). Не меняется при переоткрытии файла, в том числе после перезапуска
+// программы. Возвращает true в случае успеха.
+bool io_file_id(io_handle_t handle, uint64_t *device, uint64_t *inode);
+
+// Преобразование хэндла в целочисленный дескриптор, который видит пользователь lab2_*.
+int io_handle_to_fd(io_handle_t handle);
+
+// Выровненная память под буферы прямого ввода-вывода.
+void *io_alloc_aligned(size_t size, size_t alignment);
+void io_free_aligned(void *ptr);
+
+// Память под кадры кэша. Если huge, сначала пробуются явные большие страницы (MAP_HUGETLB
+// в Linux, MEM_LARGE_PAGES в Windows), затем прозрачные (madvise MADV_HUGEPAGE, область
+// выравнивается по IO_HUGE_PAGE_SIZE); иначе — io_alloc_aligned. В *backing записывается,
+// какая память получена. Освобождается io_free_frames с тем же размером.
+enum FrameBacking : uint8_t {
+    FRAMES_REGULAR,      // обычные страницы
+    FRAMES_HUGE,         // явные большие страницы
+    FRAMES_TRANSPARENT,  // прозрачные большие страницы (ядро может и не выделить их)
+};
+constexpr size_t IO_HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+void *io_alloc_frames(size_t size, size_t alignment, bool huge, FrameBacking *backing);
+void io_free_frames(void *ptr, size_t size, FrameBacking backing);
+
+// Возврат ОС физической памяти диапазона [ptr, ptr + size) выровненной памяти без
+// освобождения адресов: содержимое после этого не определено, при обращении память
+// выделяется снова. ptr и size кратны размеру страницы. Внутри явных больших страниц
+// память не возвращается (вызов ничего не делает).
+void io_discard(void *ptr, size_t size);
+
+#endif // PAGE_CACHE_IO_H
@@ -0,0 +1,492 @@
+//
+// Отображение файла кэша в память через userfaultfd (см. page-cache-mmap.h).
+//
+
+#include "page-cache-mmap.h"
+#include "page-cache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+#ifdef PAGE_CACHE_HAVE_USERFAULTFD
+
+#include <linux/userfaultfd.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <csignal>
+
+namespace {
+
+constexpr uint8_t PAGE_PRESENT = 1;  // страница загружена в отображение
+constexpr uint8_t PAGE_DIRTY = 2;    // загруженная страница изменена (защита от записи снята)
+
+struct Mapping {
+    char* base;
+    size_t len;
+    int fd;
+    off_t offset;
+    // Состояние страниц (PAGE_*) и признак удаления отображения — под handler.pages_mutex
+    std::vector<uint8_t> pages;
+    bool removed = false;
+};
+
+// Один userfaultfd и один поток-обработчик на процесс; создаются при первом lab2_mmap
+struct FaultHandler {
+    std::once_flag started;
+    int uffd = -1;
+    int stop_fd = -1;             // eventfd, будит обработчик при завершении
+    bool thread_id = false;       // ядро сообщает поток, обратившийся к странице
+    size_t page_size = 4096;
+    std::thread thread;
+
+    std::shared_mutex mutex;
+    std::map<uintptr_t, std::shared_ptr<Mapping>> mappings;  // по адресу начала
+    std::atomic<size_t> mapping_count{0};  // без отображений кэш не берёт мьютексы
+
+    // Загрузка, защита и удаление страниц и их состояние. Берётся и под мьютексом шарда
+    // (mmap_detach_block), поэтому под ним нельзя обращаться к кэшу
+    std::mutex pages_mutex;
+
+    ~FaultHandler() {
+        if (thread.joinable()) {
+            uint64_t one = 1;
+            (void)!write(stop_fd, &one, sizeof(one));
+            thread.join();
+        }
+        if (uffd != -1) {
+            close(uffd);
+        }
+        if (stop_fd != -1) {
+            close(stop_fd);
+        }
+    }
+};
+
+FaultHandler handler;
+
+std::shared_ptr<Mapping> find_mapping(uintptr_t addr) {
+    std::shared_lock<std::shared_mutex> lock(handler.mutex);
+    auto it = handler.mappings.upper_bound(addr);
+    if (it == handler.mappings.begin()) {
+        return nullptr;
+    }
+    --it;
+    const Mapping& mapping = *it->second;
+    return addr < reinterpret_cast<uintptr_t>(mapping.base) + mapping.len ? it->second : nullptr;
+}
+
+// ioctl над userfaultfd с повтором при EAGAIN (область в это время меняется) и EINTR.
+// Возвращает 0 или errno
+int uffd_ioctl(unsigned long request, void* arg) {
+    while (ioctl(handler.uffd, request, arg) == -1) {
+        if (errno != EAGAIN && errno != EINTR) {
+            return errno;
+        }
+    }
+    return 0;
+}
+
+bool write_protect(uintptr_t addr, size_t len, bool protect) {
+    uffdio_writeprotect wp{};
+    wp.range.start = addr;
+    wp.range.len = len;
+    wp.mode = protect ? UFFDIO_WRITEPROTECT_MODE_WP : 0;
+    return uffd_ioctl(UFFDIO_WRITEPROTECT, &wp) == 0;
+}
+
+// Пробуждение потоков, ждущих страницу addr. Ошибка означает, что области уже нет
+// и ждать в ней некому
+void wake(uintptr_t addr) {
+    uffdio_range range{addr, handler.page_size};
+    uffd_ioctl(UFFDIO_WAKE, &range);
+}
+
+// Обращение к странице не может быть обслужено: страница остаётся незагруженной, а поток
+// получает SIGBUS (без сведений о потоке — процесс). Обработчик сигнала, вернувший управление,
+// приводит к новому обращению и новой попытке загрузки
+void fail_access(uint32_t tid) {
+    if (handler.thread_id && tid != 0) {
+        syscall(SYS_tgkill, getpid(), tid, SIGBUS);
+    } else {
+        kill(getpid(), SIGBUS);
+    }
+}
+
+// Загрузка страницы addr и остальных страниц её блока из кадра кэша. Страницы, загруженные
+// раньше, пропускаются. Записываемая страница сразу грязная и без защиты. Кадр закреплён
+// cache_pin_mapped, поэтому блок не вытесняется, пока страницы копируются
+void populate(Mapping& mapping, uintptr_t addr, bool writing, uint32_t tid) {
+    size_t page = handler.page_size;
+    uintptr_t base = reinterpret_cast<uintptr_t>(mapping.base);
+    off_t offset = mapping.offset + static_cast<off_t>(addr - base);
+    off_t block_offset = block_start(offset);
+    uintptr_t block_addr = addr - static_cast<uintptr_t>(offset - block_offset);  // адрес начала блока
+    uintptr_t first = std::max<uintptr_t>(base, block_addr);
+    uintptr_t last = std::min<uintptr_t>(base + mapping.len, block_addr + block_size);
+
+    const char* frame = cache_pin_mapped(mapping.fd, block_offset);
+    if (frame == nullptr) {
+        fail_access(tid);
+        return;
+    }
+    bool loaded = true;
+    {
+        std::lock_guard<std::mutex> lock(handler.pages_mutex);
+        for (uintptr_t dst = first; dst < last && !mapping.removed; dst += page) {
+            uint8_t& state = mapping.pages[(dst - base) / page];
+            if (state & PAGE_PRESENT) {
+                continue;
+            }
+            bool dirty = writing && dst == addr;
+            uffdio_copy copy{};
+            copy.dst = dst;
+            copy.src = reinterpret_cast<uintptr_t>(frame) + (dst - block_addr);
+            copy.len = page;
+            copy.mode = UFFDIO_COPY_MODE_DONTWAKE | (dirty ? 0 : UFFDIO_COPY_MODE_WP);
+            int error = uffd_ioctl(UFFDIO_COPY, &copy);
+            if (error == 0) {
+                state = PAGE_PRESENT | (dirty ? PAGE_DIRTY : 0);
+            } else if (error == EEXIST) {
+                state = PAGE_PRESENT;  // защищена от записи: запись придёт отдельным событием WP
+            } else if (dst == addr) {
+                loaded = false;
+            }
+        }
+        loaded = loaded || mapping.removed;
+    }
+    lab2_put_page(frame);
+    if (loaded) {
+        wake(addr);
+    } else {
+        fail_access(tid);
+    }
+}
+
+// Первая запись в загруженную страницу: страница становится грязной, защита снимается
+// (это же будит поток). Если страницу успели удалить, поток загрузит её заново
+void make_writable(Mapping& mapping, uintptr_t addr, uint32_t tid) {
+    std::unique_lock<std::mutex> lock(handler.pages_mutex);
+    uint8_t& state = mapping.pages[(addr - reinterpret_cast<uintptr_t>(mapping.base)) / handler.page_size];
+    if (mapping.removed || !(state & PAGE_PRESENT)) {
+        lock.unlock();
+        wake(addr);
+        return;
+    }
+    if (!write_protect(addr, handler.page_size, false)) {
+        lock.unlock();
+        fail_access(tid);
+        return;
+    }
+    state |= PAGE_DIRTY;
+}
+
+void handle_faults() {
+    pollfd fds[2] = {{handler.uffd, POLLIN, 0}, {handler.stop_fd, POLLIN, 0}};
+    for (;;) {
+        if (poll(fds, 2, -1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        if (fds[1].revents != 0) {
+            return;
+        }
+        // poll может сообщить о событии, которое уже забрано: uffd неблокирующий (EAGAIN)
+        uffd_msg msg;
+        ssize_t n = read(handler.uffd, &msg, sizeof(msg));
+        if (n != sizeof(msg) || msg.event != UFFD_EVENT_PAGEFAULT) {
+            continue;
+        }
+        uintptr_t addr = msg.arg.pagefault.address & ~static_cast<uintptr_t>(handler.page_size - 1);
+        uint32_t tid = handler.thread_id ? msg.arg.pagefault.feat.ptid : 0;
+        std::shared_ptr<Mapping> mapping = find_mapping(addr);
+        if (!mapping) {
+            wake(addr);  // область удаляется
+            continue;
+        }
+        if (msg.arg.pagefault.flags & UFFD_PAGEFAULT_FLAG_WP) {
+            make_writable(*mapping, addr, tid);
+        } else {
+            populate(*mapping, addr, (msg.arg.pagefault.flags & UFFD_PAGEFAULT_FLAG_WRITE) != 0, tid);
+        }
+    }
+}
+
+// userfaultfd с обработкой и ядерных обращений (read() в отображение и т.п.) требует прав;
+// без них — только обращения из пользовательского режима
+int open_uffd() {
+    int uffd = static_cast<int>(syscall(SYS_userfaultfd, O_CLOEXEC | O_NONBLOCK));
+#ifdef UFFD_USER_MODE_ONLY
+    if (uffd == -1 && errno == EPERM) {
+        uffd = static_cast<int>(syscall(SYS_userfaultfd, O_CLOEXEC | O_NONBLOCK | UFFD_USER_MODE_ONLY));
+    }
+#endif
+    return uffd;
+}
+
+bool start_handler() {
+    handler.page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    // UFFDIO_API можно вызвать на userfaultfd только раз: первый узнаёт возможности ядра,
+    // второй включает нужные
+    int uffd = open_uffd();
+    if (uffd == -1) {
+        return false;
+    }
+    uffdio_api api{UFFD_API, 0, 0};
+    bool probed = ioctl(uffd, UFFDIO_API, &api) == 0;
+    close(uffd);
+    // без защиты от записи изменённые страницы не отличить от загруженных
+    if (!probed || (api.features & UFFD_FEATURE_PAGEFAULT_FLAG_WP) == 0) {
+        return false;
+    }
+    uffd = open_uffd();
+    if (uffd == -1) {
+        return false;
+    }
+    api = {UFFD_API, UFFD_FEATURE_PAGEFAULT_FLAG_WP | (api.features & UFFD_FEATURE_THREAD_ID), 0};
+    if (ioctl(uffd, UFFDIO_API, &api) == -1) {
+        close(uffd);
+        return false;
+    }
+    handler.stop_fd = eventfd(0, EFD_CLOEXEC);
+    if (handler.stop_fd == -1) {
+        close(uffd);
+        return false;
+    }
+    handler.uffd = uffd;
+    handler.thread_id = (api.features & UFFD_FEATURE_THREAD_ID) != 0;
+    handler.thread = std::thread(handle_faults);
+    return true;
+}
+
+// Перенос грязных страниц [from, to) отображения в кэш: по вызову cache_sync_mapped
+// на каждый блок с грязными страницами
+int sync_pages(Mapping& mapping, size_t from, size_t to) {
+    size_t page = handler.page_size;
+    std::vector<off_t> blocks;
+    {
+        std::lock_guard<std::mutex> lock(handler.pages_mutex);
+        for (size_t i = from; i < to; ++i) {
+            if (mapping.pages[i] & PAGE_DIRTY) {
+                off_t block_offset = block_start(mapping.offset + static_cast<off_t>(i * page));
+                if (blocks.empty() || blocks.back() != block_offset) {
+                    blocks.push_back(block_offset);
+                }
+            }
+        }
+    }
+    for (off_t block_offset : blocks) {
+        cache_sync_mapped(mapping.fd, block_offset);
+    }
+    return 0;
+}
+
+} // namespace
+
+size_t mmap_page_size() {
+    return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+void* mmap_create(int fd, off_t offset, size_t len) {
+    static bool ready = false;
+    std::call_once(handler.started, [] { ready = start_handler(); });
+    size_t page = handler.page_size;
+    if (!ready || len == 0 || offset < 0 || offset % page != 0 || page > block_size) {
+        return nullptr;
+    }
+    len = (len + page - 1) / page * page;
+    void* area = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (area == MAP_FAILED) {
+        return nullptr;
+    }
+    uffdio_register reg{};
+    reg.range.start = reinterpret_cast<uintptr_t>(area);
+    reg.range.len = len;
+    reg.mode = UFFDIO_REGISTER_MODE_MISSING | UFFDIO_REGISTER_MODE_WP;
+    if (ioctl(handler.uffd, UFFDIO_REGISTER, &reg) == -1) {
+        munmap(area, len);
+        return nullptr;
+    }
+
+    auto mapping = std::make_shared<Mapping>();
+    mapping->base = static_cast<char*>(area);
+    mapping->len = len;
+    mapping->fd = fd;
+    mapping->offset = offset;
+    mapping->pages.resize(len / page);
+    std::unique_lock<std::shared_mutex> lock(handler.mutex);
+    handler.mappings[reg.range.start] = mapping;
+    handler.mapping_count++;
+    return area;
+}
+
+int mmap_sync(void* addr, size_t len) {
+    uintptr_t start = reinterpret_cast<uintptr_t>(addr);
+    std::shared_ptr<Mapping> mapping = find_mapping(start);
+    if (!mapping || len == 0) {
+        return -1;
+    }
+    size_t page = handler.page_size;
+    uintptr_t base = reinterpret_cast<uintptr_t>(mapping->base);
+    size_t from = (start - base) / page;
+    size_t to = std::min((start - base + len + page - 1) / page, mapping->len / page);
+    return sync_pages(*mapping, from, to);
+}
+
+int mmap_sync_file(int fd) {
+    std::vector<std::shared_ptr<Mapping>> file_mappings;
+    {
+        std::shared_lock<std::shared_mutex> lock(handler.mutex);
+        for (auto& [start, mapping] : handler.mappings) {
+            if (mapping->fd == fd) {
+                file_mappings.push_back(mapping);
+            }
+        }
+    }
+    int result = 0;
+    for (const auto& mapping : file_mappings) {
+        if (sync_pages(*mapping, 0, mapping->len / handler.page_size) != 0) {
+            result = -1;
+        }
+    }
+    return result;
+}
+
+int mmap_destroy(void* addr, size_t len) {
+    std::shared_ptr<Mapping> mapping = find_mapping(reinterpret_cast<uintptr_t>(addr));
+    size_t page = handler.page_size;
+    if (!mapping || mapping->base != addr || (len + page - 1) / page * page != mapping->len) {
+        return -1;
+    }
+    // пока отображение в списке, обращения к нему ещё обслуживаются
+    int result = sync_pages(*mapping, 0, mapping->len / page);
+    {
+        std::unique_lock<std::shared_mutex> lock(handler.mutex);
+        if (handler.mappings.erase(reinterpret_cast<uintptr_t>(addr)) == 0) {
+            return -1;  // удалено параллельным вызовом
+        }
+        handler.mapping_count--;
+    }
+    {
+        // обработчик, уже нашедший отображение, больше не загружает в него страницы
+        std::lock_guard<std::mutex> lock(handler.pages_mutex);
+        mapping->removed = true;
+    }
+    // munmap снимает регистрацию и сам, поэтому ошибка UFFDIO_UNREGISTER не мешает удалению
+    uffdio_range range{reinterpret_cast<uintptr_t>(mapping->base), mapping->len};
+    uffd_ioctl(UFFDIO_UNREGISTER, &range);
+    if (munmap(mapping->base, mapping->len) != 0) {
+        result = -1;
+    }
+    return result;
+}
+
+bool mmap_in_use(int fd) {
+    std::shared_lock<std::shared_mutex> lock(handler.mutex);
+    for (auto& [start, mapping] : handler.mappings) {
+        if (mapping->fd == fd) {
+            return true;
+        }
+    }
+    return false;
+}
+
+SectorMask mmap_detach_block(int fd, off_t block_offset, char* data, bool unmap) {
+    if (handler.mapping_count.load(std::memory_order_acquire) == 0) {
+        return 0;
+    }
+    size_t page = handler.page_size;
+    off_t block_end = block_offset + static_cast<off_t>(block_size);
+    SectorMask copied = 0;
+    std::shared_lock<std::shared_mutex> lock(handler.mutex);
+    std::lock_guard<std::mutex> pages_lock(handler.pages_mutex);
+    for (auto& [start, mapping] : handler.mappings) {
+        off_t from = std::max(block_offset, mapping->offset);
+        off_t to = std::min(block_end, mapping->offset + static_cast<off_t>(mapping->len));
+        if (mapping->fd != fd || from >= to) {
+            continue;
+        }
+        // При unmap удаляются подряд идущие страницы [zap_from, offset); грязная страница,
+        // которую не удалось защитить, остаётся в отображении и разрывает этот отрезок
+        off_t zap_from = from;
+        auto zap = [&](off_t zap_to) {
+            if (unmap && zap_from < zap_to &&
+                madvise(mapping->base + (zap_from - mapping->offset), static_cast<size_t>(zap_to - zap_from),
+                        MADV_DONTNEED) == 0) {
+                for (off_t offset = zap_from; offset < zap_to; offset += static_cast<off_t>(page)) {
+                    mapping->pages[(offset - mapping->offset) / page] = 0;
+                }
+            }
+        };
+        for (off_t offset = from; offset < to; offset += static_cast<off_t>(page)) {
+            char* addr = mapping->base + (offset - mapping->offset);
+            uint8_t& state = mapping->pages[(offset - mapping->offset) / page];
+            if (!(state & PAGE_DIRTY)) {
+                continue;
+            }
+            // Страница копируется только под защитой от записи: запись другого потока после
+            // защиты ждёт обработчика (make_writable, под pages_mutex) и снова делает её
+            // грязной. Не удалось защитить — страница не копируется и остаётся грязной
+            if (!write_protect(reinterpret_cast<uintptr_t>(addr), page, true)) {
+                zap(offset);
+                zap_from = offset + static_cast<off_t>(page);
+                continue;
+            }
+            // грязная страница загружена, поэтому её чтение не обращается к обработчику
+            size_t in_block = static_cast<size_t>(offset - block_offset);
+            memcpy(data + in_block, addr, page);
+            copied |= sector_span(in_block, in_block + page);
+            state &= ~PAGE_DIRTY;
+        }
+        zap(to);
+    }
+    return copied;
+}
+
+#else // PAGE_CACHE_HAVE_USERFAULTFD
+
+// Без userfaultfd отображения не поддерживаются
+size_t mmap_page_size() {
+    return 4096;
+}
+
+void* mmap_create(int /*fd*/, off_t /*offset*/, size_t /*len*/) {
+    return nullptr;
+}
+
+int mmap_sync(void* /*addr*/, size_t /*len*/) {
+    return -1;
+}
+
+int mmap_sync_file(int /*fd*/) {
+    return 0;
+}
+
+int mmap_destroy(void* /*addr*/, size_t /*len*/) {
+    return -1;
+}
+
+bool mmap_in_use(int /*fd*/) {
+    return false;
+}
+
+SectorMask mmap_detach_block(int /*fd*/, off_t /*block_offset*/, char* /*data*/, bool /*unmap*/) {
+    return 0;
+}
+
+#endif // PAGE_CACHE_HAVE_USERFAULTFD
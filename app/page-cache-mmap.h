@@ -0,0 +1,64 @@
+//
+// Отображение файла кэша в память (lab2_mmap) через userfaultfd.
+// Область — анонимная память, зарегистрированная в userfaultfd. При первом обращении к странице
+// поток-обработчик копирует в неё данные кадра кэша (UFFDIO_COPY), заодно и остальные страницы
+// того же блока. Загруженные страницы защищены от записи (режим WP, Linux 5.7+): первая запись
+// в страницу отмечает её грязной и снимает защиту.
+//
+// Страницы отображения живут, пока их блок в кэше. Когда кэш вытесняет блок или меняет его
+// кадр (lab2_write, возврат страницы lab2_get_page_writable), он вызывает mmap_detach_block:
+// грязные страницы блока переносятся в кадр (блок становится грязным), а страницы блока
+// удаляются из отображений и при следующем обращении загружаются заново. Поэтому память
+// отображений не превышает памяти кэша, а записи через lab2_write видны в отображении.
+// mmap_sync переносит грязные страницы в кэш так же, без удаления (cache_sync_mapped).
+//
+// Если блок не удалось прочитать, обращение к странице не обслуживается, а поток получает
+// SIGBUS, как при ошибке ввода-вывода в отображении файла ОС.
+// Буфер lab2_read/lab2_write не должен лежать в отображении: обработчику может понадобиться
+// тот же шард кэша.
+//
+
+#ifndef PAGE_CACHE_MMAP_H
+#define PAGE_CACHE_MMAP_H
+
+#include "page-cache-block.h"
+
+#include <cstddef>
+#include <sys/types.h>
+
+// Размер страницы отображения; offset в mmap_create должен быть ему кратен
+size_t mmap_page_size();
+
+// Новое отображение [offset, offset + len) файла fd; файл должен быть не короче offset + len.
+// Возвращает адрес или nullptr (нет userfaultfd или WP, страница ОС больше блока кэша, нет памяти)
+void* mmap_create(int fd, off_t offset, size_t len);
+
+// Перенос грязных страниц [addr, addr + len) в кэш. Возвращает 0 или -1
+int mmap_sync(void* addr, size_t len);
+
+// Перенос в кэш грязных страниц всех отображений файла fd. Возвращает 0 или -1
+int mmap_sync_file(int fd);
+
+// Перенос грязных страниц и удаление отображения; addr и len — как при создании.
+// Возвращает 0 или -1
+int mmap_destroy(void* addr, size_t len);
+
+// Есть ли у файла отображения
+bool mmap_in_use(int fd);
+
+// Страницы отображений файла fd, лежащие в блоке block_offset с кадром data (вызывается
+// под мьютексом шарда блока). Грязные страницы защищаются от записи и копируются в кадр;
+// страница, которую не удалось защитить, остаётся грязной и не копируется. При unmap
+// остальные страницы блока удаляются из отображений.
+// Возвращает маску секторов кадра, скопированных из отображений
+SectorMask mmap_detach_block(int fd, off_t block_offset, char* data, bool unmap);
+
+// Кадр блока block_offset файла fd, закреплённый до lab2_put_page, или nullptr (для загрузки
+// страниц; без трассы и счётчиков попаданий). Реализован в page-cache.cpp
+const char* cache_pin_mapped(int fd, off_t block_offset);
+
+// Перенос грязных страниц отображений блока block_offset файла fd в кэш (для mmap_sync,
+// вызывается без мьютексов кэша). Реализован в page-cache.cpp
+void cache_sync_mapped(int fd, off_t block_offset);
+
+#endif // PAGE_CACHE_MMAP_H
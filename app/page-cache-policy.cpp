@@ -0,0 +1,425 @@
+//
+// Реализация политик вытеснения.
+//
+
+#include "page-cache-policy.h"
+#include "page-cache.h"
+
+#include <algorithm>
+#include <list>
+#include <unordered_map>
+
+namespace {
+
+// Интрузивный двусвязный список блоков (поля policy_prev/policy_next в CacheBlock).
+// Вставка и удаление за O(1) без аллокаций.
+class BlockList {
+public:
+    void push_back(CacheBlock* block) {
+        block->policy_prev = tail;
+        block->policy_next = nullptr;
+        if (tail) {
+            tail->policy_next = block;
+        } else {
+            head = block;
+        }
+        tail = block;
+        count++;
+    }
+
+    void push_front(CacheBlock* block) {
+        block->policy_prev = nullptr;
+        block->policy_next = head;
+        if (head) {
+            head->policy_prev = block;
+        } else {
+            tail = block;
+        }
+        head = block;
+        count++;
+    }
+
+    void remove(CacheBlock* block) {
+        if (block->policy_prev) {
+            block->policy_prev->policy_next = block->policy_next;
+        } else {
+            head = block->policy_next;
+        }
+        if (block->policy_next) {
+            block->policy_next->policy_prev = block->policy_prev;
+        } else {
+            tail = block->policy_prev;
+        }
+        block->policy_prev = block->policy_next = nullptr;
+        count--;
+    }
+
+    CacheBlock* pop_front() {
+        CacheBlock* block = head;
+        if (block) {
+            remove(block);
+        }
+        return block;
+    }
+
+    // Первый от головы блок, который можно вытеснить
+    CacheBlock* first_evictable() const {
+        for (CacheBlock* block = head; block; block = block->policy_next) {
+            if (block_evictable(block)) {
+                return block;
+            }
+        }
+        return nullptr;
+    }
+
+    // Извлечение первого от головы блока, который можно вытеснить
+    CacheBlock* pop_evictable() {
+        CacheBlock* block = first_evictable();
+        if (block) {
+            remove(block);
+        }
+        return block;
+    }
+
+    // Добавление блоков в out от хвоста к голове (при pred — только блоков, для которых он истинен)
+    template <typename Pred>
+    void append_reversed(std::vector<CacheBlock*>& out, Pred pred) const {
+        for (CacheBlock* block = tail; block; block = block->policy_prev) {
+            if (pred(block)) {
+                out.push_back(block);
+            }
+        }
+    }
+
+    void append_reversed(std::vector<CacheBlock*>& out) const {
+        append_reversed(out, [](const CacheBlock*) { return true; });
+    }
+
+    CacheBlock* front() const { return head; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+private:
+    CacheBlock* head = nullptr;
+    CacheBlock* tail = nullptr;
+    size_t count = 0;
+};
+
+// "Призрачная" очередь: ключи недавно вытесненных блоков без данных, FIFO ограниченного размера
+class GhostQueue {
+public:
+    explicit GhostQueue(size_t capacity) : capacity(capacity) {}
+
+    void push(const BlockKey& key) {
+        if (capacity == 0) {
+            return;
+        }
+        erase(key);
+        order.push_back(key);
+        index[key] = std::prev(order.end());
+        trim();
+    }
+
+    void set_capacity(size_t new_capacity) {
+        capacity = new_capacity;
+        trim();
+    }
+
+    // Удаляет ключ, если он есть. Возвращает true, если ключ был в очереди
+    bool erase(const BlockKey& key) {
+        auto it = index.find(key);
+        if (it == index.end()) {
+            return false;
+        }
+        order.erase(it->second);
+        index.erase(it);
+        return true;
+    }
+
+private:
+    void trim() {
+        while (order.size() > capacity) {
+            index.erase(order.front());
+            order.pop_front();
+        }
+    }
+
+    size_t capacity;
+    std::list<BlockKey> order;
+    std::unordered_map<BlockKey, std::list<BlockKey>::iterator, PairHash> index;
+};
+
+// FIFO: вытесняется самый старый блок независимо от обращений
+class FifoPolicy : public EvictionPolicy {
+public:
+    void on_insert(CacheBlock* block) override { queue.push_back(block); }
+    void on_access(CacheBlock*) override {}
+    void on_remove(CacheBlock* block) override { queue.remove(block); }
+    CacheBlock* evict() override { return queue.pop_evictable(); }
+    void restore(CacheBlock* victim) override { queue.push_front(victim); }
+    void ranked(std::vector<CacheBlock*>& out) const override { queue.append_reversed(out); }
+
+private:
+    BlockList queue;
+};
+
+// LRU: при обращении блок переносится в хвост, вытесняется голова
+class LruPolicy : public EvictionPolicy {
+public:
+    void on_insert(CacheBlock* block) override { queue.push_back(block); }
+
+    void on_access(CacheBlock* block) override {
+        queue.remove(block);
+        queue.push_back(block);
+    }
+
+    void on_remove(CacheBlock* block) override { queue.remove(block); }
+    CacheBlock* evict() override { return queue.pop_evictable(); }
+    void restore(CacheBlock* victim) override { queue.push_front(victim); }
+    void ranked(std::vector<CacheBlock*>& out) const override { queue.append_reversed(out); }
+
+private:
+    BlockList queue;
+};
+
+// CLOCK (second chance): при обращении ставится бит, стрелка пропускает блоки
+// с установленным битом, сбрасывая его
+class ClockPolicy : public EvictionPolicy {
+public:
+    void on_insert(CacheBlock* block) override {
+        block->policy_bits = 0;
+        ring.push_back(block);
+    }
+
+    void on_access(CacheBlock* block) override { block->policy_bits = 1; }
+    void on_remove(CacheBlock* block) override { ring.remove(block); }
+
+    CacheBlock* evict() override {
+        // голова списка — позиция стрелки; пройденные блоки уходят в хвост.
+        // За два оборота биты сброшены у всех, так что дальше остаются только закреплённые блоки
+        for (size_t step = 0, limit = 2 * ring.size() + 1; step < limit && !ring.empty(); ++step) {
+            CacheBlock* block = ring.pop_front();
+            if (block->policy_bits == 0 && block_evictable(block)) {
+                return block;
+            }
+            block->policy_bits = 0;
+            ring.push_back(block);
+        }
+        return nullptr;
+    }
+
+    // стрелка остаётся на жертве; сброшенные по пути биты не восстанавливаются
+    void restore(CacheBlock* victim) override { ring.push_front(victim); }
+
+    // сначала блоки с битом обращения, затем остальные; в каждой части — от недавно пройденных
+    void ranked(std::vector<CacheBlock*>& out) const override {
+        ring.append_reversed(out, [](const CacheBlock* block) { return block->policy_bits != 0; });
+        ring.append_reversed(out, [](const CacheBlock* block) { return block->policy_bits == 0; });
+    }
+
+private:
+    BlockList ring;
+};
+
+// 2Q (Johnson, Shasha): новые блоки попадают в FIFO A1in, вытесненные из него ключи
+// запоминаются в A1out. Повторное обращение к ключу из A1out переводит блок в LRU Am.
+class TwoQueuePolicy : public EvictionPolicy {
+public:
+    explicit TwoQueuePolicy(size_t capacity)
+        : kin(std::max<size_t>(1, capacity / 4)), a1out(capacity / 2) {}
+
+    void on_insert(CacheBlock* block) override {
+        if (a1out.erase(block_key(block))) {
+            block->policy_queue = QUEUE_AM;
+            am.push_back(block);
+        } else {
+            block->policy_queue = QUEUE_A1IN;
+            a1in.push_back(block);
+        }
+    }
+
+    void on_access(CacheBlock* block) override {
+        // обращения в A1in не продвигают блок: это защищает Am от коротких всплесков
+        if (block->policy_queue == QUEUE_AM) {
+            am.remove(block);
+            am.push_back(block);
+        }
+    }
+
+    void on_remove(CacheBlock* block) override { queue_of(block).remove(block); }
+
+    CacheBlock* evict() override {
+        if (a1in.size() > kin || am.empty()) {
+            if (CacheBlock* block = evict_a1in()) {
+                return block;
+            }
+        }
+        if (CacheBlock* block = am.pop_evictable()) {
+            return block;
+        }
+        return evict_a1in();
+    }
+
+    void restore(CacheBlock* victim) override {
+        if (victim->policy_queue == QUEUE_A1IN) {
+            a1out.erase(block_key(victim));
+        }
+        queue_of(victim).push_front(victim);
+    }
+
+    void ranked(std::vector<CacheBlock*>& out) const override {
+        am.append_reversed(out);
+        a1in.append_reversed(out);
+    }
+
+    void set_capacity(size_t capacity) override {
+        kin = std::max<size_t>(1, capacity / 4);
+        a1out.set_capacity(capacity / 2);
+    }
+
+private:
+    enum : uint8_t { QUEUE_A1IN, QUEUE_AM };
+
+    BlockList& queue_of(const CacheBlock* block) {
+        return block->policy_queue == QUEUE_AM ? am : a1in;
+    }
+
+    CacheBlock* evict_a1in() {
+        CacheBlock* block = a1in.pop_evictable();
+        if (block) {
+            a1out.push(block_key(block));
+        }
+        return block;
+    }
+
+    size_t kin;        // целевой размер A1in
+    BlockList a1in;
+    BlockList am;
+    GhostQueue a1out;
+};
+
+// S3-FIFO (Yang et al., SOSP'23): маленькая FIFO S (10%) отсекает блоки с единственным
+// обращением, основная FIFO M (90%) с повторной вставкой по счётчику частоты, призрачная G
+// возвращает недавно отсеянные ключи сразу в M.
+class S3FifoPolicy : public EvictionPolicy {
+public:
+    explicit S3FifoPolicy(size_t capacity)
+        : small_target(std::max<size_t>(1, capacity / 10)), ghost(capacity - capacity / 10) {}
+
+    void on_insert(CacheBlock* block) override {
+        block->policy_bits = 0;
+        if (ghost.erase(block_key(block))) {
+            block->policy_queue = QUEUE_MAIN;
+            main_queue.push_back(block);
+        } else {
+            block->policy_queue = QUEUE_SMALL;
+            small_queue.push_back(block);
+        }
+    }
+
+    void on_access(CacheBlock* block) override {
+        if (block->policy_bits < MAX_FREQ) {
+            block->policy_bits++;
+        }
+    }
+
+    void on_remove(CacheBlock* block) override {
+        (block->policy_queue == QUEUE_MAIN ? main_queue : small_queue).remove(block);
+    }
+
+    CacheBlock* evict() override {
+        // каждый шаг либо вытесняет блок, либо уменьшает его счётчик (не больше MAX_FREQ раз),
+        // либо пропускает закреплённый — ограничиваем число шагов, чтобы не зациклиться на них
+        size_t limit = (MAX_FREQ + 2) * (small_queue.size() + main_queue.size()) + 1;
+        size_t small_pinned = 0;  // пропущено закреплённых блоков в S и M
+        size_t main_pinned = 0;
+        for (size_t step = 0; step < limit; ++step) {
+            bool small_has_candidates = small_pinned < small_queue.size();
+            bool main_has_candidates = main_pinned < main_queue.size();
+            if (!small_has_candidates && !main_has_candidates) {
+                break;
+            }
+            if (small_has_candidates && (small_queue.size() >= small_target || !main_has_candidates)) {
+                CacheBlock* block = small_queue.pop_front();
+                if (!block_evictable(block)) {
+                    small_queue.push_back(block);
+                    small_pinned++;
+                    continue;
+                }
+                if (block->policy_bits > 0) {
+                    // к блоку обращались, пока он был в S — переводим в M
+                    block->policy_bits = 0;
+                    block->policy_queue = QUEUE_MAIN;
+                    main_queue.push_back(block);
+                    continue;
+                }
+                ghost.push(block_key(block));
+                return block;
+            }
+            CacheBlock* block = main_queue.pop_front();
+            if (!block_evictable(block)) {
+                main_queue.push_back(block);
+                main_pinned++;
+                continue;
+            }
+            if (block->policy_bits > 0) {
+                block->policy_bits--;
+                main_queue.push_back(block);
+                continue;
+            }
+            return block;
+        }
+        return nullptr;
+    }
+
+    void restore(CacheBlock* victim) override {
+        if (victim->policy_queue == QUEUE_SMALL) {
+            ghost.erase(block_key(victim));
+            small_queue.push_front(victim);
+        } else {
+            main_queue.push_front(victim);
+        }
+    }
+
+    // M по убыванию счётчика частоты, затем S: блоки с обращениями перейдут в M
+    void ranked(std::vector<CacheBlock*>& out) const override {
+        for (int freq = MAX_FREQ; freq >= 0; --freq) {
+            main_queue.append_reversed(out, [freq](const CacheBlock* block) { return block->policy_bits == freq; });
+        }
+        small_queue.append_reversed(out, [](const CacheBlock* block) { return block->policy_bits != 0; });
+        small_queue.append_reversed(out, [](const CacheBlock* block) { return block->policy_bits == 0; });
+    }
+
+    void set_capacity(size_t capacity) override {
+        small_target = std::max<size_t>(1, capacity / 10);
+        ghost.set_capacity(capacity - capacity / 10);
+    }
+
+private:
+    enum : uint8_t { QUEUE_SMALL, QUEUE_MAIN };
+    static constexpr uint8_t MAX_FREQ = 3;
+
+    size_t small_target;  // целевой размер S
+    BlockList small_queue;
+    BlockList main_queue;
+    GhostQueue ghost;
+};
+
+} // namespace
+
+std::unique_ptr<EvictionPolicy> make_eviction_policy(int policy, size_t capacity) {
+    switch (policy) {
+        case LAB2_POLICY_FIFO:
+            return std::make_unique<FifoPolicy>();
+        case LAB2_POLICY_LRU:
+            return std::make_unique<LruPolicy>();
+        case LAB2_POLICY_CLOCK:
+            return std::make_unique<ClockPolicy>();
+        case LAB2_POLICY_2Q:
+            return std::make_unique<TwoQueuePolicy>(capacity);
+        case LAB2_POLICY_S3FIFO:
+            return std::make_unique<S3FifoPolicy>(capacity);
+        default:
+            return nullptr;
+    }
+}
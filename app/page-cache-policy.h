@@ -0,0 +1,53 @@
+//
+// Политики вытеснения блоков кэша: FIFO, LRU, CLOCK, 2Q, S3-FIFO.
+// Политика только упорядочивает блоки и выбирает жертву; память блоков и blocks_map
+// остаются за page-cache.cpp.
+//
+
+#ifndef PAGE_CACHE_POLICY_H
+#define PAGE_CACHE_POLICY_H
+
+#include "page-cache-block.h"
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+class EvictionPolicy {
+public:
+    virtual ~EvictionPolicy() = default;
+
+    // Блок добавлен в кэш (промах или превентивная загрузка)
+    virtual void on_insert(CacheBlock* block) = 0;
+
+    // Попадание в блок
+    virtual void on_access(CacheBlock* block) = 0;
+
+    // Блок удаляется из кэша не по вытеснению (например, при закрытии файла)
+    virtual void on_remove(CacheBlock* block) = 0;
+
+    // Выбор жертвы среди блоков, которые можно вытеснить (block_evictable).
+    // Блок исключается из структур политики, освобождает его вызывающий.
+    // Возвращает nullptr, если подходящих блоков нет.
+    virtual CacheBlock* evict() = 0;
+
+    // Отмена последнего evict(): жертва остаётся в кэше (например, фильтр допуска
+    // отклонил кандидата) и возвращается на прежнее место в очереди.
+    virtual void restore(CacheBlock* victim) = 0;
+
+    // Добавление в out всех блоков политики от самых ценных к ближайшим кандидатам
+    // на вытеснение (снимок кэша, lab2_save_state). Порядок приблизителен: биты обращений
+    // и счётчики частоты учитываются не точнее, чем при вытеснении
+    virtual void ranked(std::vector<CacheBlock*>& out) const = 0;
+
+    // Ёмкость кэша изменилась (lab2_resize). Размеры очередей пересчитываются,
+    // лишние блоки вытесняет вызывающий
+    virtual void set_capacity(size_t /*capacity*/) {}
+};
+
+// Создание политики по идентификатору LAB2_POLICY_* (см. page-cache.h).
+// capacity — ёмкость кэша в блоках (нужна 2Q и S3-FIFO для размеров очередей).
+// Возвращает nullptr для неизвестной политики.
+std::unique_ptr<EvictionPolicy> make_eviction_policy(int policy, size_t capacity);
+
+#endif // PAGE_CACHE_POLICY_H
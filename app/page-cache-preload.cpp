@@ -0,0 +1,569 @@
+//
+// Перехват файлового ввода-вывода через LD_PRELOAD: программа, которую нельзя менять,
+// работает с файлами через libpagecache.so.
+//
+// Файлы, пути которых начинаются с префиксов из LAB2_PRELOAD_PATHS (через двоеточие),
+// открываются lab2_open_flags, и open/read/write/pread/pwrite/lseek/fsync/close над ними
+// (а также __open_2/__read_chk/__pread_chk программ, собранных с _FORTIFY_SOURCE)
+// выполняются вызовами lab2_*; остальные файлы идут прямо в libc. Программе возвращается
+// свой дескриптор того же файла, открытый повторно через libc без O_DIRECT: сам кэш читает
+// и пишет через собственный дескриптор, и его вызовы pread/pwrite/close проходят мимо
+// перехвата. fstat, mmap, copy_file_range над дескриптором программы и унаследованный им
+// после exec дескриптор работают с файлом на диске и не видят несброшенных записей.
+// Копии дескриптора (dup/dup2/dup3/fcntl F_DUPFD — так оболочка и dd перенаправляют
+// stdin/stdout) тоже перехватываются; файл кэша закрывается вместе с последней копией.
+// Перехватываются только функции libc, вызываемые программой: stdio (fopen/fread) и
+// copy_file_range ходят в ядро напрямую.
+//
+// Настройка кэша: LAB2_PRELOAD_CACHE_MB, LAB2_PRELOAD_BLOCK_SIZE, LAB2_PRELOAD_HUGE_PAGES=1,
+// LAB2_PRELOAD_VICTIM_MB (ярус сжатых вытесненных блоков);
+// LAB2_PRELOAD_STATS=1 печатает статистику кэша в stderr при завершении программы.
+//
+// Запуск: LD_PRELOAD=libpagecache-preload.so LAB2_PRELOAD_PATHS=/data программа ...
+//
+
+#include "page-cache.h"
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+static_assert(sizeof(off_t) == 8, "перехват рассчитан на 64-битный off_t (pread64 == pread)");
+
+namespace {
+
+constexpr int MAX_ROUTED_FD = 65536;  // Дескрипторы с большими номерами не перехватываются
+
+// Режим доступа, с которым программа открыла файл
+enum RouteMode : uint8_t {
+    ROUTE_READ = 0x1,
+    ROUTE_WRITE = 0x2,
+    ROUTE_APPEND = 0x4,
+};
+
+// Функции libc, которые перехват подменяет
+struct RealCalls {
+    int (*open)(const char*, int, ...);
+    int (*openat)(int, const char*, int, ...);
+    ssize_t (*read)(int, void*, size_t);
+    ssize_t (*write)(int, const void*, size_t);
+    ssize_t (*pread)(int, void*, size_t, off_t);
+    ssize_t (*pwrite)(int, const void*, size_t, off_t);
+    off_t (*lseek)(int, off_t, int);
+    int (*fsync)(int);
+    int (*fdatasync)(int);
+    int (*close)(int);
+    int (*dup)(int);
+    int (*dup2)(int, int);
+    int (*dup3)(int, int, int);
+    int (*fcntl)(int, int, ...);
+};
+
+template <typename F>
+void resolve(F& f, const char* name) {
+    f = reinterpret_cast<F>(dlsym(RTLD_NEXT, name));
+}
+
+RealCalls& real() {
+    static RealCalls calls = [] {
+        RealCalls c{};
+        resolve(c.open, "open");
+        resolve(c.openat, "openat");
+        resolve(c.read, "read");
+        resolve(c.write, "write");
+        resolve(c.pread, "pread");
+        resolve(c.pwrite, "pwrite");
+        resolve(c.lseek, "lseek");
+        resolve(c.fsync, "fsync");
+        resolve(c.fdatasync, "fdatasync");
+        resolve(c.close, "close");
+        resolve(c.dup, "dup");
+        resolve(c.dup2, "dup2");
+        resolve(c.dup3, "dup3");
+        resolve(c.fcntl, "fcntl");
+        return c;
+    }();
+    return calls;
+}
+
+// Дескриптор программы -> дескриптор кэша + 1 (0 — файл не перехвачен) и режим доступа
+std::atomic<int> routed[MAX_ROUTED_FD];
+std::atomic<uint8_t> routed_mode[MAX_ROUTED_FD];
+std::atomic<int> aliases[MAX_ROUTED_FD];  // Дескриптор кэша -> число дескрипторов программы
+
+std::vector<std::string> prefixes;  // LAB2_PRELOAD_PATHS без завершающих '/'
+std::once_flag configured;
+int stats_fd = -1;  // Копия stderr для статистики: программы вроде dd закрывают stderr до выхода
+
+// Поток внутри lab2_open_flags: open из самого кэша идёт в libc
+thread_local bool in_cache_open = false;
+
+size_t env_size(const char* name, size_t fallback) {
+    const char* value = getenv(name);
+    return value != nullptr && *value != '\0' ? std::strtoull(value, nullptr, 10) : fallback;
+}
+
+// Префиксы путей и параметры кэша из окружения; кэш настраивается при первом перехваченном open
+void configure() {
+    if (const char* paths = getenv("LAB2_PRELOAD_PATHS")) {
+        std::string list = paths;
+        size_t start = 0;
+        while (start <= list.size()) {
+            size_t end = std::min(list.find(':', start), list.size());
+            std::string prefix = list.substr(start, end - start);
+            while (prefix.size() > 1 && prefix.back() == '/') {
+                prefix.pop_back();
+            }
+            if (!prefix.empty()) {
+                prefixes.push_back(prefix);
+            }
+            start = end + 1;
+        }
+    }
+    if (!prefixes.empty()) {
+        lab2_config config{env_size("LAB2_PRELOAD_CACHE_MB", 0) * 1024 * 1024,
+                           env_size("LAB2_PRELOAD_BLOCK_SIZE", 0),
+                           env_size("LAB2_PRELOAD_HUGE_PAGES", 0) != 0};
+        if (lab2_init(&config) != 0) {
+            fprintf(stderr, "libpagecache-preload: неверные параметры кэша, используются значения по умолчанию\n");
+        }
+        lab2_set_victim_tier(env_size("LAB2_PRELOAD_VICTIM_MB", 0) * 1024 * 1024);
+        const char* print = getenv("LAB2_PRELOAD_STATS");
+        if (print != nullptr && std::strcmp(print, "1") == 0) {
+            stats_fd = real().fcntl(STDERR_FILENO, F_DUPFD_CLOEXEC, 3);
+        }
+    }
+}
+
+// Попадает ли путь под один из префиксов. Относительный путь дополняется текущим каталогом;
+// символьные ссылки и «..» не раскрываются
+bool matches(int dirfd, const char* path) {
+    std::call_once(configured, configure);
+    if (prefixes.empty() || path == nullptr) {
+        return false;
+    }
+    std::string full;
+    if (path[0] == '/') {
+        full = path;
+    } else if (dirfd == AT_FDCWD) {
+        char cwd[4096];
+        if (getcwd(cwd, sizeof(cwd)) == nullptr) {
+            return false;
+        }
+        full = std::string(cwd) + "/" + path;
+    } else {
+        return false;  // путь относительно другого каталога
+    }
+    for (const std::string& prefix : prefixes) {
+        if (full.compare(0, prefix.size(), prefix) == 0 &&
+            (full.size() == prefix.size() || full[prefix.size()] == '/' || prefix == "/")) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Открытие через кэш. Возвращает дескриптор программы, -1 с errno, если файла нет
+// (или он есть при O_EXCL), и -2, если файл не подходит кэшу и открывается через libc
+int open_routed(const char* path, int flags) {
+    if ((flags & (O_DIRECTORY | O_PATH)) != 0) {
+        return -2;
+    }
+    int lab2_flags = 0;
+    lab2_flags |= (flags & O_CREAT) ? LAB2_OPEN_CREATE : 0;
+    lab2_flags |= (flags & O_EXCL) ? LAB2_OPEN_EXCLUSIVE : 0;
+    // O_TRUNC без права записи POSIX не определяет; Linux обрезает, мы — нет
+    lab2_flags |= (flags & O_TRUNC) && (flags & O_ACCMODE) != O_RDONLY ? LAB2_OPEN_TRUNCATE : 0;
+
+    in_cache_open = true;
+    int cache_fd = lab2_open_flags(path, lab2_flags);
+    in_cache_open = false;
+    if (cache_fd == -1) {
+        // каталог, файл без права записи и т.п. — пусть откроет libc
+        return errno == ENOENT || errno == EEXIST ? -1 : -2;
+    }
+    int fd = real().open(path, flags & ~(O_CREAT | O_EXCL | O_TRUNC | O_DIRECT));
+    if (fd == -1 || fd >= MAX_ROUTED_FD || cache_fd >= MAX_ROUTED_FD) {
+        if (fd != -1) {
+            real().close(fd);
+        }
+        lab2_close(cache_fd);
+        return -2;
+    }
+    uint8_t mode = 0;
+    mode |= (flags & O_ACCMODE) != O_WRONLY ? ROUTE_READ : 0;
+    mode |= (flags & O_ACCMODE) != O_RDONLY ? ROUTE_WRITE : 0;
+    mode |= (flags & O_APPEND) ? ROUTE_APPEND : 0;
+    aliases[cache_fd].store(1, std::memory_order_relaxed);
+    routed_mode[fd].store(mode, std::memory_order_relaxed);
+    routed[fd].store(cache_fd + 1, std::memory_order_release);
+    return fd;
+}
+
+// Дескриптор кэша для дескриптора программы или -1
+int cache_fd_of(int fd) {
+    if (fd < 0 || fd >= MAX_ROUTED_FD) {
+        return -1;
+    }
+    return routed[fd].load(std::memory_order_acquire) - 1;
+}
+
+// Снятие перехвата с дескриптора программы; с последней копией закрывается файл кэша
+// (грязные блоки сбрасываются на диск; если сброс не удался, файл кэша остаётся открытым,
+// и его блоки дописывает фоновая запись). Возвращает false, если дескриптор не перехвачен
+bool unroute(int fd, int* result) {
+    if (fd < 0 || fd >= MAX_ROUTED_FD) {
+        return false;
+    }
+    int cache_fd = routed[fd].exchange(0, std::memory_order_acq_rel) - 1;
+    if (cache_fd == -1) {
+        return false;
+    }
+    *result = aliases[cache_fd].fetch_sub(1, std::memory_order_acq_rel) == 1 ? lab2_close(cache_fd) : 0;
+    return true;
+}
+
+// Копия newfd перехваченного дескриптора fd работает с тем же файлом кэша и той же позицией.
+// Возвращает newfd или -1, если копию не удалось учесть (она закрывается)
+int add_alias(int fd, int newfd) {
+    int cache_fd = cache_fd_of(fd);
+    if (newfd == -1 || cache_fd == -1) {
+        return newfd;
+    }
+    if (newfd >= MAX_ROUTED_FD) {
+        real().close(newfd);
+        errno = EMFILE;
+        return -1;
+    }
+    aliases[cache_fd].fetch_add(1, std::memory_order_relaxed);
+    routed_mode[newfd].store(routed_mode[fd].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    routed[newfd].store(cache_fd + 1, std::memory_order_release);
+    return newfd;
+}
+
+// Копия в заданный номер: прежний перехваченный newfd сначала отпускается
+int dup_to(int fd, int newfd, int flags) {
+    if (fd == newfd) {
+        return flags == 0 ? real().dup2(fd, newfd) : real().dup3(fd, newfd, flags);
+    }
+    int ignored;
+    unroute(newfd, &ignored);
+    return add_alias(fd, flags == 0 ? real().dup2(fd, newfd) : real().dup3(fd, newfd, flags));
+}
+
+// Проверка режима доступа: запись в файл, открытый только для чтения, и наоборот — EBADF
+bool allowed(int fd, uint8_t need) {
+    if ((routed_mode[fd].load(std::memory_order_relaxed) & need) == 0) {
+        errno = EBADF;
+        return false;
+    }
+    return true;
+}
+
+// lab2_* не всегда выставляют errno: ошибка без причины — EIO
+template <typename T>
+T checked(T result, int saved_errno) {
+    if (result < 0 && errno == saved_errno) {
+        errno = EIO;
+    }
+    return result;
+}
+
+// Чтение до конца файла, как у read: lab2_pread за концом файла возвращает нули
+size_t clamp_to_size(int cache_fd, size_t count, off_t offset) {
+    off_t size = lab2_file_size(cache_fd);
+    if (size <= offset) {
+        return 0;
+    }
+    return static_cast<size_t>(std::min<off_t>(static_cast<off_t>(count), size - offset));
+}
+
+int open_common(int dirfd, const char* path, int flags, mode_t mode) {
+    if (!in_cache_open && matches(dirfd, path)) {
+        int fd = open_routed(path, flags);
+        if (fd != -2) {
+            return fd;
+        }
+    }
+    return dirfd == AT_FDCWD ? real().open(path, flags, mode) : real().openat(dirfd, path, flags, mode);
+}
+
+// Статистика и сброс незакрытых файлов при завершении программы
+struct PreloadShutdown {
+    ~PreloadShutdown() {
+        if (prefixes.empty()) {
+            return;
+        }
+        for (int fd = 0; fd < MAX_ROUTED_FD; ++fd) {
+            int ignored;
+            unroute(fd, &ignored);
+        }
+        if (stats_fd != -1) {
+            lab2_stats stats{};
+            lab2_get_stats(&stats);
+            uint64_t lookups = stats.hits + stats.misses;
+            dprintf(stats_fd, "libpagecache-preload: hits %llu, misses %llu (%.1f%%), read %llu bytes, written %llu bytes\n",
+                    static_cast<unsigned long long>(stats.hits), static_cast<unsigned long long>(stats.misses),
+                    lookups > 0 ? 100.0 * stats.hits / lookups : 0.0,
+                    static_cast<unsigned long long>(stats.bytes_read),
+                    static_cast<unsigned long long>(stats.bytes_written));
+        }
+    }
+};
+
+PreloadShutdown preload_shutdown;
+
+} // namespace
+
+extern "C" {
+
+int open(const char* path, int flags, ...) {
+    mode_t mode = 0;
+    if (flags & (O_CREAT | O_TMPFILE)) {
+        va_list args;
+        va_start(args, flags);
+        mode = va_arg(args, mode_t);
+        va_end(args);
+    }
+    return open_common(AT_FDCWD, path, flags, mode);
+}
+
+int open64(const char* path, int flags, ...) {
+    mode_t mode = 0;
+    if (flags & (O_CREAT | O_TMPFILE)) {
+        va_list args;
+        va_start(args, flags);
+        mode = va_arg(args, mode_t);
+        va_end(args);
+    }
+    return open_common(AT_FDCWD, path, flags, mode);
+}
+
+int openat(int dirfd, const char* path, int flags, ...) {
+    mode_t mode = 0;
+    if (flags & (O_CREAT | O_TMPFILE)) {
+        va_list args;
+        va_start(args, flags);
+        mode = va_arg(args, mode_t);
+        va_end(args);
+    }
+    // абсолютный путь не зависит от dirfd: его учитывают и matches, и openat
+    return open_common(dirfd, path, flags, mode);
+}
+
+int openat64(int dirfd, const char* path, int flags, ...) {
+    mode_t mode = 0;
+    if (flags & (O_CREAT | O_TMPFILE)) {
+        va_list args;
+        va_start(args, flags);
+        mode = va_arg(args, mode_t);
+        va_end(args);
+    }
+    return open_common(dirfd, path, flags, mode);
+}
+
+// Варианты с проверками _FORTIFY_SOURCE: в них программа попадает, минуя open/read/pread.
+// __open_2 вызывается только без mode, поэтому O_CREAT в нём — ошибка программы, как и в libc
+void __chk_fail() __attribute__((noreturn));
+
+int __open_2(const char* path, int flags) {
+    if (flags & (O_CREAT | O_TMPFILE)) {
+        abort();
+    }
+    return open_common(AT_FDCWD, path, flags, 0);
+}
+
+int __open64_2(const char* path, int flags) {
+    return __open_2(path, flags);
+}
+
+int __openat_2(int dirfd, const char* path, int flags) {
+    if (flags & (O_CREAT | O_TMPFILE)) {
+        abort();
+    }
+    return open_common(dirfd, path, flags, 0);
+}
+
+int __openat64_2(int dirfd, const char* path, int flags) {
+    return __openat_2(dirfd, path, flags);
+}
+
+ssize_t read(int fd, void* buf, size_t count) {
+    int cache_fd = cache_fd_of(fd);
+    if (cache_fd == -1) {
+        return real().read(fd, buf, count);
+    }
+    if (!allowed(fd, ROUTE_READ)) {
+        return -1;
+    }
+    int saved_errno = errno;
+    off_t position = lab2_lseek(cache_fd, 0, SEEK_CUR);
+    if (position < 0) {
+        return checked<ssize_t>(-1, saved_errno);
+    }
+    size_t n = clamp_to_size(cache_fd, count, position);
+    return n == 0 ? 0 : checked(lab2_read(cache_fd, buf, n), saved_errno);
+}
+
+ssize_t write(int fd, const void* buf, size_t count) {
+    int cache_fd = cache_fd_of(fd);
+    if (cache_fd == -1) {
+        return real().write(fd, buf, count);
+    }
+    if (!allowed(fd, ROUTE_WRITE)) {
+        return -1;
+    }
+    int saved_errno = errno;
+    if ((routed_mode[fd].load(std::memory_order_relaxed) & ROUTE_APPEND) && lab2_lseek(cache_fd, 0, SEEK_END) < 0) {
+        return checked<ssize_t>(-1, saved_errno);
+    }
+    return checked(lab2_write(cache_fd, buf, count), saved_errno);
+}
+
+ssize_t pread(int fd, void* buf, size_t count, off_t offset) {
+    int cache_fd = cache_fd_of(fd);
+    if (cache_fd == -1) {
+        return real().pread(fd, buf, count, offset);
+    }
+    if (!allowed(fd, ROUTE_READ)) {
+        return -1;
+    }
+    if (offset < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    int saved_errno = errno;
+    size_t n = clamp_to_size(cache_fd, count, offset);
+    return n == 0 ? 0 : checked(lab2_pread(cache_fd, buf, n, offset), saved_errno);
+}
+
+ssize_t pread64(int fd, void* buf, size_t count, off_t offset) {
+    return pread(fd, buf, count, offset);
+}
+
+ssize_t __read_chk(int fd, void* buf, size_t count, size_t buf_size) {
+    if (count > buf_size) {
+        __chk_fail();
+    }
+    return read(fd, buf, count);
+}
+
+ssize_t __pread_chk(int fd, void* buf, size_t count, off_t offset, size_t buf_size) {
+    if (count > buf_size) {
+        __chk_fail();
+    }
+    return pread(fd, buf, count, offset);
+}
+
+ssize_t __pread64_chk(int fd, void* buf, size_t count, off_t offset, size_t buf_size) {
+    return __pread_chk(fd, buf, count, offset, buf_size);
+}
+
+ssize_t pwrite(int fd, const void* buf, size_t count, off_t offset) {
+    int cache_fd = cache_fd_of(fd);
+    if (cache_fd == -1) {
+        return real().pwrite(fd, buf, count, offset);
+    }
+    if (!allowed(fd, ROUTE_WRITE)) {
+        return -1;
+    }
+    if (offset < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    int saved_errno = errno;
+    return checked(lab2_pwrite(cache_fd, buf, count, offset), saved_errno);
+}
+
+ssize_t pwrite64(int fd, const void* buf, size_t count, off_t offset) {
+    return pwrite(fd, buf, count, offset);
+}
+
+off_t lseek(int fd, off_t offset, int whence) {
+    int cache_fd = cache_fd_of(fd);
+    if (cache_fd == -1) {
+        return real().lseek(fd, offset, whence);
+    }
+    if (whence != SEEK_SET && whence != SEEK_CUR && whence != SEEK_END) {
+        errno = EINVAL;  // SEEK_DATA/SEEK_HOLE кэш не знает
+        return -1;
+    }
+    off_t result = lab2_lseek(cache_fd, offset, whence);
+    if (result < 0) {
+        errno = EINVAL;
+    }
+    return result;
+}
+
+off_t lseek64(int fd, off_t offset, int whence) {
+    return lseek(fd, offset, whence);
+}
+
+int fsync(int fd) {
+    int cache_fd = cache_fd_of(fd);
+    if (cache_fd == -1) {
+        return real().fsync(fd);
+    }
+    int saved_errno = errno;
+    return checked(lab2_fsync(cache_fd), saved_errno);
+}
+
+int fdatasync(int fd) {
+    int cache_fd = cache_fd_of(fd);
+    if (cache_fd == -1) {
+        return real().fdatasync(fd);
+    }
+    int saved_errno = errno;
+    return checked(lab2_fsync(cache_fd), saved_errno);
+}
+
+int close(int fd) {
+    int saved_errno = errno;
+    int result;
+    if (!unroute(fd, &result)) {
+        return real().close(fd);
+    }
+    // дескриптор программы закрывается, даже если сброс не удался
+    real().close(fd);
+    return checked(result, saved_errno);
+}
+
+int dup(int fd) {
+    return add_alias(fd, real().dup(fd));
+}
+
+int dup2(int fd, int newfd) {
+    return dup_to(fd, newfd, 0);
+}
+
+int dup3(int fd, int newfd, int flags) {
+    return dup_to(fd, newfd, flags);
+}
+
+int fcntl(int fd, int cmd, ...) {
+    va_list args;
+    va_start(args, cmd);
+    void* arg = va_arg(args, void*);
+    va_end(args);
+    int result = real().fcntl(fd, cmd, arg);
+    return cmd == F_DUPFD || cmd == F_DUPFD_CLOEXEC ? add_alias(fd, result) : result;
+}
+
+int fcntl64(int fd, int cmd, ...) {
+    va_list args;
+    va_start(args, cmd);
+    void* arg = va_arg(args, void*);
+    va_end(args);
+    return fcntl(fd, cmd, arg);
+}
+
+} // extern "C"
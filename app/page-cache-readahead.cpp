@@ -0,0 +1,110 @@
+//
+// Адаптивное упреждающее чтение (см. page-cache-readahead.h).
+//
+
+#include "page-cache-readahead.h"
+
+#include <algorithm>
+
+void Readahead::on_read(int64_t first_block, int64_t last_block, std::vector<ReadaheadRange>& out) {
+    if (!has_prev) {
+        has_prev = true;
+        prev_first = first_block;
+        prev_last = last_block;
+        return;
+    }
+    // Запрос внутри предыдущего (мелкие чтения в пределах блока) шаблон не меняет
+    if (first_block >= prev_first && last_block <= prev_last) {
+        return;
+    }
+
+    int64_t delta = first_block - prev_first;
+    Pattern seen;
+    if (first_block >= prev_first && first_block <= prev_last + 1 && last_block > prev_last) {
+        seen = PATTERN_FORWARD;
+    } else if (first_block < prev_first && last_block + 1 >= prev_first && last_block <= prev_last) {
+        seen = PATTERN_REVERSE;
+    } else if (delta == stride && delta != 0) {
+        seen = PATTERN_STRIDED;
+    } else {
+        seen = PATTERN_NONE;
+    }
+
+    if (seen == pattern && seen != PATTERN_NONE) {
+        confirmations++;
+    } else {
+        // шаблон сменился или сломался — окно начинается заново
+        pattern = seen;
+        confirmations = seen != PATTERN_NONE ? 1 : 0;
+        window = 0;
+    }
+    stride = delta;
+    prev_first = first_block;
+    prev_last = last_block;
+
+    if (pattern == PATTERN_NONE || confirmations < READAHEAD_TRIGGER) {
+        return;
+    }
+    switch (pattern) {
+        case PATTERN_FORWARD:
+            issue_forward(last_block, out);
+            break;
+        case PATTERN_REVERSE:
+            issue_reverse(first_block, out);
+            break;
+        case PATTERN_STRIDED:
+            issue_strided(first_block, last_block - first_block + 1, out);
+            break;
+        default:
+            break;
+    }
+}
+
+void Readahead::grow_window() {
+    window = window == 0 ? READAHEAD_MIN_BLOCKS : std::min(window * 2, READAHEAD_MAX_BLOCKS);
+}
+
+// Окно сразу за прочитанным. Следующее окно — когда в загруженном осталось не больше половины
+void Readahead::issue_forward(int64_t last_block, std::vector<ReadaheadRange>& out) {
+    if (window == 0) {
+        ahead = last_block + 1;
+    } else if (ahead - (last_block + 1) > window / 2) {
+        return;
+    }
+    int64_t start = std::max(ahead, last_block + 1);
+    grow_window();
+    out.push_back({start, window});
+    ahead = start + window;
+}
+
+// Окно перед прочитанным, к началу файла
+void Readahead::issue_reverse(int64_t first_block, std::vector<ReadaheadRange>& out) {
+    if (window == 0) {
+        ahead = first_block;
+    } else if (first_block - ahead > window / 2) {
+        return;
+    }
+    int64_t end = std::min(ahead, first_block);
+    grow_window();
+    int64_t start = std::max<int64_t>(0, end - window);
+    if (start < end) {
+        out.push_back({start, static_cast<uint32_t>(end - start)});
+    }
+    ahead = start;
+}
+
+// Будущие запросы first_block + k * stride той же длины; окно делится между ними
+void Readahead::issue_strided(int64_t first_block, int64_t length, std::vector<ReadaheadRange>& out) {
+    int64_t depth = std::max<int64_t>(1, window / length);
+    if (window == 0 || (ahead - first_block) / stride < 1) {
+        ahead = first_block + stride;  // начало или читатель обогнал загрузку
+    } else if ((ahead - first_block) / stride - 1 > depth / 2) {
+        return;
+    }
+    grow_window();
+    depth = std::max<int64_t>(1, window / length);
+    while ((ahead - first_block) / stride <= depth && ahead >= 0) {
+        out.push_back({ahead, static_cast<uint32_t>(length)});
+        ahead += stride;
+    }
+}
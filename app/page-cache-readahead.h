@@ -0,0 +1,59 @@
+//
+// Адаптивное упреждающее чтение (readahead) для одного файла.
+// По последовательности запросов lab2_read определяется шаблон доступа: прямой
+// последовательный, обратный или с постоянным шагом. Пока шаблон не подтвердился
+// (случайный доступ), ничего не загружается. На подтверждённом шаблоне окно растёт
+// от READAHEAD_MIN_BLOCKS до READAHEAD_MAX_BLOCKS: следующее окно выдаётся, когда
+// читатель дошёл до середины предыдущего, поэтому загрузка идёт крупными порциями.
+// Класс только считает окна; загрузкой занимается page-cache.cpp.
+//
+
+#ifndef PAGE_CACHE_READAHEAD_H
+#define PAGE_CACHE_READAHEAD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+constexpr uint32_t READAHEAD_MIN_BLOCKS = 4;   // Начальное окно
+constexpr uint32_t READAHEAD_MAX_BLOCKS = 64;  // Максимальное окно (256 КБ)
+constexpr uint32_t READAHEAD_TRIGGER = 2;      // Сколько раз шаблон должен повториться
+
+// Диапазон блоков для превентивной загрузки (номера блоков, не смещения)
+struct ReadaheadRange {
+    int64_t first_block;
+    uint32_t blocks;
+};
+
+class Readahead {
+public:
+    // Учёт чтения блоков [first_block, last_block]. В out добавляются диапазоны,
+    // которые нужно загрузить заранее (для шага — по диапазону на будущий запрос)
+    void on_read(int64_t first_block, int64_t last_block, std::vector<ReadaheadRange>& out);
+
+private:
+    enum Pattern : uint8_t {
+        PATTERN_NONE,     // случайный доступ
+        PATTERN_FORWARD,  // последовательно вперёд
+        PATTERN_REVERSE,  // последовательно назад
+        PATTERN_STRIDED,  // запросы с постоянным шагом
+    };
+
+    void issue_forward(int64_t last_block, std::vector<ReadaheadRange>& out);
+    void issue_reverse(int64_t first_block, std::vector<ReadaheadRange>& out);
+    void issue_strided(int64_t first_block, int64_t length, std::vector<ReadaheadRange>& out);
+    void grow_window();
+
+    bool has_prev = false;
+    int64_t prev_first = 0;
+    int64_t prev_last = 0;
+    int64_t stride = 0;          // разница начал двух последних запросов
+    Pattern pattern = PATTERN_NONE;
+    uint32_t confirmations = 0;  // сколько запросов подряд подтвердили pattern
+    uint32_t window = 0;         // текущее окно в блоках, 0 — загрузка ещё не начата
+    int64_t ahead = 0;           // граница загруженного: FORWARD — первый не запрошенный блок,
+                                 // REVERSE — последний запрошенный снизу, STRIDED — начало
+                                 // первого будущего запроса, который ещё не загружен
+};
+
+#endif // PAGE_CACHE_READAHEAD_H
@@ -0,0 +1,144 @@
+//
+// Запись и чтение снимка кэша (см. page-cache-snapshot.h).
+//
+
+#include "page-cache-snapshot.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+void put_varint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+bool get_varint(const uint8_t*& pos, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (unsigned shift = 0; pos < end && shift < 64; shift += 7) {
+        uint8_t byte = *pos++;
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void encode_blocks(const std::vector<SnapshotBlock>& blocks, std::vector<uint8_t>& out) {
+    out.clear();
+    uint64_t previous = 0;
+    for (const SnapshotBlock& block : blocks) {
+        put_varint(out, block.block - previous);
+        previous = block.block;
+    }
+    for (const SnapshotBlock& block : blocks) {
+        put_varint(out, block.rank);
+    }
+}
+
+bool decode_blocks(const std::vector<uint8_t>& in, uint64_t count, std::vector<SnapshotBlock>& blocks) {
+    const uint8_t* pos = in.data();
+    const uint8_t* end = pos + in.size();
+    blocks.resize(count);
+    uint64_t previous = 0;
+    for (SnapshotBlock& block : blocks) {
+        uint64_t delta;
+        if (!get_varint(pos, end, delta)) {
+            return false;
+        }
+        block.block = previous + delta;
+        previous = block.block;
+    }
+    for (SnapshotBlock& block : blocks) {
+        uint64_t rank;
+        if (!get_varint(pos, end, rank) || rank > SNAPSHOT_RANK_MAX) {
+            return false;
+        }
+        block.rank = static_cast<uint32_t>(rank);
+    }
+    return pos == end;
+}
+
+} // namespace
+
+bool snapshot_save(const char* path, uint32_t block_shift, const std::vector<SnapshotFileKeys>& files) {
+    std::string temp_path = std::string(path) + ".tmp";
+    FILE* file = fopen(temp_path.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    SnapshotHeader header{};
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.block_shift = block_shift;
+    header.file_count = files.size();
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+
+    std::vector<uint8_t> encoded;
+    for (const SnapshotFileKeys& keys : files) {
+        if (!ok) {
+            break;
+        }
+        encode_blocks(keys.blocks, encoded);
+        SnapshotFile entry{keys.device, keys.inode, keys.size, keys.blocks.size(), encoded.size()};
+        ok = fwrite(&entry, sizeof(entry), 1, file) == 1 &&
+             fwrite(encoded.data(), 1, encoded.size(), file) == encoded.size();
+    }
+    ok = fclose(file) == 0 && ok;
+    if (ok) {
+#ifdef _WIN32
+        std::remove(path);  // rename в Windows не заменяет существующий файл
+#endif
+        ok = std::rename(temp_path.c_str(), path) == 0;
+    }
+    if (!ok) {
+        std::remove(temp_path.c_str());
+    }
+    return ok;
+}
+
+bool snapshot_load(const char* path, uint32_t& block_shift, std::vector<SnapshotFileKeys>& files,
+                   std::string& error) {
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) {
+        error = "не удалось открыть файл";
+        return false;
+    }
+    SnapshotHeader header{};
+    if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != SNAPSHOT_VERSION || header.block_shift >= 32) {
+        fclose(file);
+        error = "неизвестный формат снимка";
+        return false;
+    }
+    block_shift = header.block_shift;
+    files.clear();
+    std::vector<uint8_t> encoded;
+    for (uint64_t i = 0; i < header.file_count; ++i) {
+        SnapshotFile entry{};
+        // на блок приходится хотя бы по байту на номер и на ранг
+        bool ok = fread(&entry, sizeof(entry), 1, file) == 1 && entry.encoded_bytes / 2 >= entry.block_count &&
+                  entry.encoded_bytes <= (1ull << 32);
+        if (ok) {
+            encoded.resize(entry.encoded_bytes);
+            ok = fread(encoded.data(), 1, encoded.size(), file) == encoded.size();
+        }
+        SnapshotFileKeys keys;
+        if (!ok || !decode_blocks(encoded, entry.block_count, keys.blocks)) {
+            fclose(file);
+            error = "снимок повреждён";
+            return false;
+        }
+        keys.device = entry.device;
+        keys.inode = entry.inode;
+        keys.size = entry.size;
+        files.push_back(std::move(keys));
+    }
+    fclose(file);
+    return true;
+}
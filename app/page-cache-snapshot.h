@@ -0,0 +1,57 @@
+//
+// Снимок кэша для тёплого старта (lab2_save_state/lab2_load_state): какие блоки каких файлов
+// лежали в кэше и насколько они ценны. Данных блоков в снимке нет — после загрузки снимка
+// блоки заново читаются с диска, поэтому устаревший снимок влияет только на попадания.
+//
+// Формат: SnapshotHeader, затем для каждого файла SnapshotFile и encoded_bytes байт блоков:
+// номера блоков по возрастанию разностями соседних в LEB128 (первый — сам номер), за ними
+// в том же порядке ранги блоков в LEB128. Подряд идущие блоки занимают по 2–3 байта.
+//
+
+#ifndef PAGE_CACHE_SNAPSHOT_H
+#define PAGE_CACHE_SNAPSHOT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+constexpr char SNAPSHOT_MAGIC[8] = {'L', '2', 'S', 'N', 'A', 'P', '\0', '\0'};
+constexpr uint32_t SNAPSHOT_VERSION = 1;
+constexpr uint32_t SNAPSHOT_RANK_MAX = 65535;  // Ранг самого холодного блока, 0 — самого горячего
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t block_shift;  // log2 размера блока, в котором записаны номера блоков
+    uint64_t file_count;
+};
+
+struct SnapshotFile {
+    uint64_t device;         // io_file_id
+    uint64_t inode;
+    uint64_t size;           // размер файла при сохранении
+    uint64_t block_count;
+    uint64_t encoded_bytes;  // длина закодированных блоков
+};
+
+struct SnapshotBlock {
+    uint64_t block;  // номер блока в файле
+    uint32_t rank;   // 0 .. SNAPSHOT_RANK_MAX
+};
+
+struct SnapshotFileKeys {
+    uint64_t device = 0;
+    uint64_t inode = 0;
+    uint64_t size = 0;
+    std::vector<SnapshotBlock> blocks;  // по возрастанию номеров
+};
+
+// Запись снимка: сначала во временный файл рядом, затем переименование, так что прежний
+// снимок не портится при сбое. Возвращает false в случае ошибки
+bool snapshot_save(const char* path, uint32_t block_shift, const std::vector<SnapshotFileKeys>& files);
+
+// Чтение снимка целиком. Возвращает false и сообщение в error, если файл не снимок
+bool snapshot_load(const char* path, uint32_t& block_shift, std::vector<SnapshotFileKeys>& files,
+                   std::string& error);
+
+#endif // PAGE_CACHE_SNAPSHOT_H
@@ -0,0 +1,96 @@
+//
+// Статистика page-cache (см. page-cache-stats.h).
+//
+
+#include "page-cache-stats.h"
+
+#include <bit>
+
+StatsSlot stats_slots[STATS_SLOTS];
+
+static std::atomic<unsigned> next_slot{0};
+
+StatsSlot& stats_slot() {
+    static thread_local StatsSlot& slot = stats_slots[next_slot.fetch_add(1, std::memory_order_relaxed) % STATS_SLOTS];
+    return slot;
+}
+
+// Корзина i содержит задержки [2^i, 2^(i+1)) нс, последняя — всё, что больше
+void stats_latency(StatLatency kind, uint64_t start_ns) {
+    uint64_t ns = stats_now_ns() - start_ns;
+    unsigned bucket = ns == 0 ? 0 : std::bit_width(ns) - 1;
+    if (bucket >= LAB2_LATENCY_BUCKETS) {
+        bucket = LAB2_LATENCY_BUCKETS - 1;
+    }
+    auto& latency = stats_slot().latency[kind];
+    latency.count.fetch_add(1, std::memory_order_relaxed);
+    latency.total_ns.fetch_add(ns, std::memory_order_relaxed);
+    latency.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+static uint64_t take(std::atomic<uint64_t>& value, bool reset) {
+    return reset ? value.exchange(0, std::memory_order_relaxed) : value.load(std::memory_order_relaxed);
+}
+
+void stats_collect_group(uint8_t group, lab2_group_stats* out, bool reset) {
+    uint64_t counters[GROUP_COUNTERS] = {};
+    for (StatsSlot& slot : stats_slots) {
+        for (unsigned i = 0; i < GROUP_COUNTERS; ++i) {
+            counters[i] += take(slot.groups[group][i], reset);
+        }
+    }
+    out->hits = counters[GROUP_HITS];
+    out->misses = counters[GROUP_MISSES];
+    out->evictions = counters[GROUP_EVICTIONS];
+}
+
+void stats_collect(lab2_stats* out, bool reset) {
+    uint64_t counters[STAT_COUNTERS] = {};
+    lab2_latency latency[LATENCY_KINDS] = {};
+    for (StatsSlot& slot : stats_slots) {
+        for (unsigned i = 0; i < STAT_COUNTERS; ++i) {
+            counters[i] += take(slot.counters[i], reset);
+        }
+        for (unsigned kind = 0; kind < LATENCY_KINDS; ++kind) {
+            latency[kind].count += take(slot.latency[kind].count, reset);
+            latency[kind].total_ns += take(slot.latency[kind].total_ns, reset);
+            for (unsigned b = 0; b < LAB2_LATENCY_BUCKETS; ++b) {
+                latency[kind].buckets[b] += take(slot.latency[kind].buckets[b], reset);
+            }
+        }
+    }
+
+    out->hits = counters[STAT_HITS];
+    out->misses = counters[STAT_MISSES];
+    out->evictions = counters[STAT_EVICTIONS];
+    out->dirty_evictions = counters[STAT_DIRTY_EVICTIONS];
+    out->prefetch_issued = counters[STAT_PREFETCH_ISSUED];
+    out->prefetch_used = counters[STAT_PREFETCH_USED];
+    out->prefetch_wasted = counters[STAT_PREFETCH_WASTED];
+    out->bytes_read = counters[STAT_BYTES_READ];
+    out->bytes_written = counters[STAT_BYTES_WRITTEN];
+    out->disk_writes = counters[STAT_DISK_WRITES];
+    out->disk_write_bytes = counters[STAT_DISK_WRITE_BYTES];
+    out->writeback_batches = counters[STAT_WRITEBACK_BATCHES];
+    out->writeback_blocks = counters[STAT_WRITEBACK_BLOCKS];
+    out->victim_hits = counters[STAT_VICTIM_HITS];
+    out->victim_stores = counters[STAT_VICTIM_STORES];
+    out->read_latency = latency[LATENCY_READ];
+    out->write_latency = latency[LATENCY_WRITE];
+    out->fsync_latency = latency[LATENCY_FSYNC];
+}
+
+uint64_t latency_percentile(const lab2_latency& latency, double q) {
+    if (latency.count == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(q * latency.count);
+    uint64_t seen = 0;
+    for (unsigned b = 0; b < LAB2_LATENCY_BUCKETS; ++b) {
+        seen += latency.buckets[b];
+        if (seen > rank) {
+            return b + 1 >= 64 ? UINT64_MAX : uint64_t{1} << (b + 1);
+        }
+    }
+    return UINT64_MAX;
+}
@@ -0,0 +1,94 @@
+//
+// Статистика page-cache без блокировок. Счётчики и гистограммы задержек разнесены по
+// STATS_SLOTS слотам, каждый поток пишет в свой слот (выбирается по кругу при первом
+// обращении), поэтому на пути попадания стоит одно неупорядоченное атомарное сложение
+// в собственной строке кэша. Сумма по слотам собирается только в lab2_get_stats.
+//
+
+#ifndef PAGE_CACHE_STATS_H
+#define PAGE_CACHE_STATS_H
+
+#include "page-cache.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+constexpr unsigned STATS_SLOTS = 16;
+
+enum StatCounter : uint8_t {
+    STAT_HITS,
+    STAT_MISSES,
+    STAT_EVICTIONS,
+    STAT_DIRTY_EVICTIONS,
+    STAT_PREFETCH_ISSUED,
+    STAT_PREFETCH_USED,
+    STAT_PREFETCH_WASTED,
+    STAT_BYTES_READ,
+    STAT_BYTES_WRITTEN,
+    STAT_DISK_WRITES,
+    STAT_DISK_WRITE_BYTES,
+    STAT_WRITEBACK_BATCHES,
+    STAT_WRITEBACK_BLOCKS,
+    STAT_VICTIM_HITS,
+    STAT_VICTIM_STORES,
+    STAT_COUNTERS
+};
+
+enum StatLatency : uint8_t {
+    LATENCY_READ,   // lab2_read и lab2_pread
+    LATENCY_WRITE,  // lab2_write и lab2_pwrite
+    LATENCY_FSYNC,
+    LATENCY_KINDS
+};
+
+// Счётчики группы файлов (lab2_get_group_stats)
+enum GroupCounter : uint8_t {
+    GROUP_HITS,
+    GROUP_MISSES,
+    GROUP_EVICTIONS,
+    GROUP_COUNTERS
+};
+
+struct alignas(64) StatsSlot {
+    std::atomic<uint64_t> counters[STAT_COUNTERS];
+    std::atomic<uint64_t> groups[LAB2_MAX_GROUPS][GROUP_COUNTERS];
+    struct {
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> total_ns;
+        std::atomic<uint64_t> buckets[LAB2_LATENCY_BUCKETS];
+    } latency[LATENCY_KINDS];
+};
+
+extern StatsSlot stats_slots[STATS_SLOTS];
+
+// Слот текущего потока
+StatsSlot& stats_slot();
+
+inline void stats_add(StatCounter counter, uint64_t n = 1) {
+    stats_slot().counters[counter].fetch_add(n, std::memory_order_relaxed);
+}
+
+inline void stats_group_add(uint8_t group, GroupCounter counter) {
+    stats_slot().groups[group][counter].fetch_add(1, std::memory_order_relaxed);
+}
+
+// Время для замера задержки (steady_clock, без системного вызова)
+inline uint64_t stats_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Учёт операции kind, начатой в момент start_ns (см. stats_now_ns)
+void stats_latency(StatLatency kind, uint64_t start_ns);
+
+// Сумма по всем слотам; при reset счётчики обнуляются по мере чтения
+void stats_collect(lab2_stats* out, bool reset);
+
+// Счётчики группы по всем слотам (hits, misses, evictions); остальные поля out не меняются
+void stats_collect_group(uint8_t group, lab2_group_stats* out, bool reset);
+
+// Верхняя граница корзины, в которую попадает доля q (0..1) операций, в наносекундах
+uint64_t latency_percentile(const lab2_latency& latency, double q);
+
+#endif // PAGE_CACHE_STATS_H
@@ -0,0 +1,277 @@
+//
+// Воспроизведение трассы обращений (lab2_trace_start или LAB2_TRACE) через кэш страниц.
+// Трасса прогоняется заново для каждой ёмкости кэша (--capacities, МБ) и политики вытеснения,
+// с фильтром допуска и без:
+// файлы трассы создаются в --dir, операции выполняются в записанном порядке одним потоком.
+// --speed=original выдерживает исходные интервалы между операциями, --speed=max выполняет
+// их подряд. Для каждого прогона печатаются доля попаданий и задержки чтения/записи p50/p99.
+//
+// Запуск: trace-replay ТРАССА [--speed=original|max] [--dir=PATH] [--policies=fifo,lru,clock,2q,s3fifo]
+//         [--admission=off,on] [--capacities=МБ,...] [--block-size=БАЙТ]
+//
+
+#include "page-cache.h"
+#include "page-cache-trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Options {
+    std::string trace;
+    bool original_speed = false;
+    std::string dir = ".";
+    std::string policies = "fifo,lru,clock,2q,s3fifo";
+    std::string admission = "off,on";
+    std::vector<size_t> capacities_mb = {100};  // память кэша (lab2_init)
+    size_t block_size = 0;                      // 0 — по умолчанию
+};
+
+struct PolicyName {
+    const char* name;
+    int policy;
+};
+
+constexpr PolicyName POLICIES[] = {
+    {"fifo", LAB2_POLICY_FIFO},
+    {"lru", LAB2_POLICY_LRU},
+    {"clock", LAB2_POLICY_CLOCK},
+    {"2q", LAB2_POLICY_2Q},
+    {"s3fifo", LAB2_POLICY_S3FIFO},
+};
+
+struct ReplayResult {
+    bool ok = false;
+    uint64_t reads = 0;
+    uint64_t writes = 0;
+    double seconds = 0;
+    double hit_rate = 0;
+    double read_p50_us = 0, read_p99_us = 0;
+    double write_p50_us = 0, write_p99_us = 0;
+};
+
+// Есть ли name в списке через запятую
+static bool listed(const std::string& list, const char* name) {
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = std::min(list.find(',', start), list.size());
+        if (list.compare(start, end - start, name) == 0) {
+            return true;
+        }
+        start = end + 1;
+    }
+    return false;
+}
+
+static double percentile(std::vector<uint32_t>& samples, double q) {
+    if (samples.empty()) {
+        return 0;
+    }
+    auto it = samples.begin() + static_cast<size_t>(q * (samples.size() - 1));
+    std::nth_element(samples.begin(), it, samples.end());
+    return *it / 1000.0;
+}
+
+// Один прогон трассы. Файл трассы с номером N воспроизводится файлом replay-N.dat;
+// операции над файлом, открытым до начала записи трассы, открывают его при первом обращении
+static ReplayResult replay(const std::vector<TraceRecord>& records, const Options& options) {
+    ReplayResult result;
+    uint32_t max_length = 0;
+    for (const TraceRecord& record : records) {
+        max_length = std::max(max_length, record.length);
+    }
+    std::vector<char> buffer(std::max<uint32_t>(max_length, 1), 'r');
+    std::map<uint16_t, int> files;  // номер файла в трассе -> fd кэша
+    auto path_of = [&](uint16_t file) {
+        return (std::filesystem::path(options.dir) / ("replay-" + std::to_string(file) + ".dat")).string();
+    };
+    auto fd_of = [&](uint16_t file) {
+        auto it = files.find(file);
+        if (it != files.end()) {
+            return it->second;
+        }
+        int fd = lab2_open(path_of(file).c_str());
+        if (fd != -1) {
+            files[file] = fd;
+        }
+        return fd;
+    };
+
+    std::vector<uint32_t> read_latencies;
+    std::vector<uint32_t> write_latencies;
+    bool failed = false;
+    lab2_reset_stats();
+    auto start = std::chrono::steady_clock::now();
+    for (const TraceRecord& record : records) {
+        if (options.original_speed) {
+            std::this_thread::sleep_until(start + std::chrono::nanoseconds(record.time_ns));
+        }
+        auto op_start = std::chrono::steady_clock::now();
+        switch (record.op) {
+            case TRACE_OPEN: {
+                // повторное открытие в трассе — новый файл с тем же номером
+                auto it = files.find(record.file);
+                if (it != files.end()) {
+                    lab2_close(it->second);
+                    files.erase(it);
+                }
+                failed |= fd_of(record.file) == -1;
+                break;
+            }
+            case TRACE_CLOSE: {
+                auto it = files.find(record.file);
+                if (it != files.end()) {
+                    lab2_close(it->second);
+                    files.erase(it);
+                }
+                break;
+            }
+            case TRACE_READ:
+                failed |= lab2_pread(fd_of(record.file), buffer.data(), record.length, record.offset) < 0;
+                break;
+            case TRACE_WRITE:
+                failed |= lab2_pwrite(fd_of(record.file), buffer.data(), record.length, record.offset) < 0;
+                break;
+            case TRACE_FSYNC:
+                failed |= lab2_fsync(fd_of(record.file)) < 0;
+                break;
+            default:
+                break;
+        }
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - op_start);
+        uint32_t latency = static_cast<uint32_t>(std::min<int64_t>(ns.count(), UINT32_MAX));
+        if (record.op == TRACE_READ) {
+            read_latencies.push_back(latency);
+        } else if (record.op == TRACE_WRITE) {
+            write_latencies.push_back(latency);
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    lab2_stats stats{};
+    lab2_get_stats(&stats);
+    for (auto& [file, fd] : files) {
+        lab2_close(fd);
+    }
+    for (const TraceRecord& record : records) {
+        std::error_code ignored;
+        std::filesystem::remove(path_of(record.file), ignored);
+    }
+
+    result.ok = !failed;
+    result.reads = read_latencies.size();
+    result.writes = write_latencies.size();
+    result.seconds = std::chrono::duration<double>(end - start).count();
+    uint64_t lookups = stats.hits + stats.misses;
+    result.hit_rate = lookups > 0 ? static_cast<double>(stats.hits) / lookups : 0;
+    result.read_p50_us = percentile(read_latencies, 0.50);
+    result.read_p99_us = percentile(read_latencies, 0.99);
+    result.write_p50_us = percentile(write_latencies, 0.50);
+    result.write_p99_us = percentile(write_latencies, 0.99);
+    return result;
+}
+
+static bool parse_options(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&](const char* prefix) -> const char* {
+            size_t len = std::strlen(prefix);
+            return arg.compare(0, len, prefix) == 0 ? arg.c_str() + len : nullptr;
+        };
+        if (const char* v = value("--speed=")) {
+            if (std::strcmp(v, "original") != 0 && std::strcmp(v, "max") != 0) {
+                options.trace.clear();
+                break;
+            }
+            options.original_speed = std::strcmp(v, "original") == 0;
+        } else if (const char* v = value("--dir=")) {
+            options.dir = v;
+        } else if (const char* v = value("--policies=")) {
+            options.policies = v;
+        } else if (const char* v = value("--admission=")) {
+            options.admission = v;
+        } else if (const char* v = value("--capacities=")) {
+            options.capacities_mb.clear();
+            for (char* end = nullptr; *v != '\0'; v = *end == ',' ? end + 1 : end) {
+                options.capacities_mb.push_back(std::strtoull(v, &end, 10));
+                if (end == v) {
+                    break;
+                }
+            }
+        } else if (const char* v = value("--block-size=")) {
+            options.block_size = std::strtoull(v, nullptr, 10);
+        } else if (arg.compare(0, 2, "--") != 0 && options.trace.empty()) {
+            options.trace = arg;
+        } else {
+            options.trace.clear();
+            break;
+        }
+    }
+    if (options.trace.empty()) {
+        std::fprintf(stderr, "Использование: %s ТРАССА [--speed=original|max] [--dir=PATH] "
+                             "[--policies=fifo,lru,clock,2q,s3fifo] [--admission=off,on] [--capacities=МБ,...] "
+                             "[--block-size=БАЙТ]\n", argv[0]);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        return 1;
+    }
+    std::vector<TraceRecord> records;
+    std::string error;
+    if (!trace_load(options.trace.c_str(), records, error)) {
+        std::fprintf(stderr, "Ошибка чтения трассы %s: %s\n", options.trace.c_str(), error.c_str());
+        return 1;
+    }
+    double duration = records.empty() ? 0 : records.back().time_ns / 1e9;
+    std::printf("Трасса %s: %zu операций за %.3f с, скорость %s\n", options.trace.c_str(), records.size(), duration,
+                options.original_speed ? "исходная" : "максимальная");
+
+    std::printf("%8s %-7s %-9s %9s %9s %9s %7s %10s %10s %10s %10s\n", "cache", "policy", "admission", "reads",
+                "writes", "seconds", "hit", "rd p50,us", "rd p99,us", "wr p50,us", "wr p99,us");
+    for (size_t capacity_mb : options.capacities_mb) {
+        // ёмкость, как и политику, можно задать только без открытых файлов: прогоны закрывают всё
+        lab2_config config{capacity_mb * 1024 * 1024, options.block_size, 0};
+        if (lab2_init(&config) != 0) {
+            std::printf("%5zu MB ошибка настройки кэша\n", capacity_mb);
+            continue;
+        }
+        for (const PolicyName& policy : POLICIES) {
+            if (!listed(options.policies, policy.name)) {
+                continue;
+            }
+            for (int admission : {0, 1}) {
+                const char* admission_name = admission ? "on" : "off";
+                if (!listed(options.admission, admission_name)) {
+                    continue;
+                }
+                if (lab2_set_eviction_policy(policy.policy) != 0 || lab2_set_admission_filter(admission) != 0) {
+                    std::printf("%5zu MB %-7s %-9s ошибка настройки\n", capacity_mb, policy.name, admission_name);
+                    continue;
+                }
+                ReplayResult result = replay(records, options);
+                if (!result.ok) {
+                    std::printf("%5zu MB %-7s %-9s ошибка\n", capacity_mb, policy.name, admission_name);
+                    continue;
+                }
+                std::printf("%5zu MB %-7s %-9s %9llu %9llu %9.3f %6.1f%% %10.1f %10.1f %10.1f %10.1f\n",
+                            capacity_mb, policy.name, admission_name, static_cast<unsigned long long>(result.reads),
+                            static_cast<unsigned long long>(result.writes), result.seconds, result.hit_rate * 100,
+                            result.read_p50_us, result.read_p99_us, result.write_p50_us, result.write_p99_us);
+                std::fflush(stdout);
+            }
+        }
+    }
+    return 0;
+}
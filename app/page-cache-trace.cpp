@@ -0,0 +1,116 @@
+//
+// Запись и чтение трассы обращений (см. page-cache-trace.h).
+//
+
+#include "page-cache-trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+std::atomic<bool> trace_enabled{false};
+
+constexpr size_t TRACE_BUFFER_RECORDS = 4096;  // Записи копятся в памяти и пишутся порциями (96 КБ)
+
+namespace {
+
+struct TraceWriter {
+    std::mutex mutex;
+    FILE* file = nullptr;
+    std::chrono::steady_clock::time_point start;
+    std::vector<TraceRecord> buffer;
+
+    // Вызывается под mutex
+    void flush() {
+        if (file != nullptr && !buffer.empty()) {
+            fwrite(buffer.data(), sizeof(TraceRecord), buffer.size(), file);
+        }
+        buffer.clear();
+    }
+
+    void close() {
+        flush();
+        if (file != nullptr) {
+            fclose(file);
+            file = nullptr;
+        }
+    }
+
+    // Остаток трассы дописывается при завершении процесса
+    ~TraceWriter() {
+        std::lock_guard<std::mutex> lock(mutex);
+        close();
+    }
+};
+
+TraceWriter writer;
+
+} // namespace
+
+bool trace_start(const char* path) {
+    std::lock_guard<std::mutex> lock(writer.mutex);
+    writer.close();
+    writer.file = fopen(path, "wb");
+    if (writer.file == nullptr) {
+        trace_enabled = false;
+        return false;
+    }
+    TraceHeader header{};
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.record_size = sizeof(TraceRecord);
+    fwrite(&header, sizeof(header), 1, writer.file);
+    writer.buffer.reserve(TRACE_BUFFER_RECORDS);
+    writer.start = std::chrono::steady_clock::now();
+    trace_enabled = true;
+    return true;
+}
+
+void trace_stop() {
+    std::lock_guard<std::mutex> lock(writer.mutex);
+    trace_enabled = false;
+    writer.close();
+}
+
+void trace_append(TraceOp op, int fd, off_t offset, size_t length) {
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(writer.mutex);
+    if (writer.file == nullptr) {
+        return;  // трассу остановили, пока операция шла
+    }
+    TraceRecord record{};
+    record.time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now - writer.start).count();
+    record.offset = static_cast<uint64_t>(offset);
+    record.length = static_cast<uint32_t>(std::min<size_t>(length, UINT32_MAX));
+    record.file = static_cast<uint16_t>(fd);
+    record.op = op;
+    writer.buffer.push_back(record);
+    if (writer.buffer.size() >= TRACE_BUFFER_RECORDS) {
+        writer.flush();
+    }
+}
+
+bool trace_load(const char* path, std::vector<TraceRecord>& records, std::string& error) {
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) {
+        error = "не удалось открыть файл";
+        return false;
+    }
+    TraceHeader header{};
+    if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != TRACE_VERSION || header.record_size != sizeof(TraceRecord)) {
+        fclose(file);
+        error = "неизвестный формат трассы";
+        return false;
+    }
+    records.clear();
+    TraceRecord chunk[1024];
+    size_t count;
+    while ((count = fread(chunk, sizeof(TraceRecord), std::size(chunk), file)) > 0) {
+        records.insert(records.end(), chunk, chunk + count);
+    }
+    fclose(file);
+    return true;
+}
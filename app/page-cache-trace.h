@@ -0,0 +1,62 @@
+//
+// Трасса обращений к кэшу: каждый вызов lab2_open/close/read/write/pread/pwrite/fsync
+// (и выдача страниц) записывается как (время, операция, файл, смещение, длина).
+// Данных файлов в трассе нет, только шаблон доступа, поэтому её можно передавать
+// и воспроизводить с другими параметрами кэша (см. page-cache-trace-replay.cpp).
+//
+// Формат: TraceHeader, затем записи TraceRecord по 24 байта (little-endian, как в памяти).
+//
+
+#ifndef PAGE_CACHE_TRACE_H
+#define PAGE_CACHE_TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+constexpr char TRACE_MAGIC[8] = {'L', '2', 'T', 'R', 'A', 'C', 'E', '\0'};
+constexpr uint32_t TRACE_VERSION = 1;
+
+enum TraceOp : uint8_t {
+    TRACE_OPEN = 1,
+    TRACE_CLOSE,
+    TRACE_READ,   // lab2_read, lab2_pread, lab2_get_page
+    TRACE_WRITE,  // lab2_write, lab2_pwrite, lab2_get_page_writable
+    TRACE_FSYNC,
+};
+
+struct TraceHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+};
+
+struct TraceRecord {
+    uint64_t time_ns;  // от начала записи трассы
+    uint64_t offset;   // абсолютное смещение (для lab2_read/lab2_write — позиция файла)
+    uint32_t length;
+    uint16_t file;     // дескриптор файла (младшие 16 бит) — только идентификатор
+    uint8_t op;        // TraceOp
+    uint8_t reserved;
+};
+static_assert(sizeof(TraceRecord) == 24, "запись трассы должна занимать 24 байта");
+
+extern std::atomic<bool> trace_enabled;
+
+bool trace_start(const char* path);
+void trace_stop();
+void trace_append(TraceOp op, int fd, off_t offset, size_t length);
+
+// Запись операции, если трасса включена. Без трассы — одна неупорядоченная загрузка
+inline void trace_record(TraceOp op, int fd, off_t offset = 0, size_t length = 0) {
+    if (trace_enabled.load(std::memory_order_relaxed)) {
+        trace_append(op, fd, offset, length);
+    }
+}
+
+// Чтение трассы целиком. Возвращает false и сообщение в error, если файл не трасса
+bool trace_load(const char* path, std::vector<TraceRecord>& records, std::string& error);
+
+#endif // PAGE_CACHE_TRACE_H
@@ -0,0 +1,91 @@
+//
+// Реализация яруса вытесненных блоков (см. page-cache-victim.h).
+//
+
+#include "page-cache-victim.h"
+#include "page-cache-compress.h"
+
+#include <limits>
+#include <cstring>
+#include <vector>
+
+void VictimTier::set_budget(size_t bytes) {
+    budget = bytes;
+    trim();
+}
+
+bool VictimTier::put(const BlockKey& key, const char* data, size_t size) {
+    if (budget == 0) {
+        return false;
+    }
+    erase(key);
+    Entry entry;
+    entry.key = key;
+    if (!block_pattern(data, size, &entry.pattern)) {
+        // буфер сжатия переиспользуется: ярус пополняется под мьютексом шарда на каждом вытеснении
+        thread_local std::vector<char> buffer;
+        buffer.resize(size / VICTIM_MAX_RATIO);
+        size_t compressed = lz_compress(data, size, buffer.data(), buffer.size());
+        if (compressed == 0 || compressed + VICTIM_ENTRY_OVERHEAD > budget) {
+            return false;
+        }
+        entry.data.reset(new char[compressed]);
+        memcpy(entry.data.get(), buffer.data(), compressed);
+        entry.size = static_cast<uint32_t>(compressed);
+    }
+    used += footprint(entry);
+    order.push_back(std::move(entry));
+    index.emplace(key, std::prev(order.end()));
+    trim();
+    return true;
+}
+
+bool VictimTier::take(const BlockKey& key, char* out, size_t size) {
+    auto it = index.find(key);
+    if (it == index.end()) {
+        return false;
+    }
+    const Entry& entry = *it->second;
+    bool ok = true;
+    if (entry.size == 0) {
+        memset(out, entry.pattern, size);
+    } else {
+        ok = lz_decompress(entry.data.get(), entry.size, out, size);
+    }
+    remove(it->second);
+    return ok;
+}
+
+void VictimTier::erase(const BlockKey& key) {
+    auto it = index.find(key);
+    if (it != index.end()) {
+        remove(it->second);
+    }
+}
+
+void VictimTier::erase_file(int fd) {
+    auto it = index.lower_bound(BlockKey(fd, std::numeric_limits<off_t>::min()));
+    while (it != index.end() && it->first.first == fd) {
+        EntryList::iterator entry = it->second;
+        ++it;
+        remove(entry);
+    }
+}
+
+void VictimTier::clear() {
+    index.clear();
+    order.clear();
+    used = 0;
+}
+
+void VictimTier::remove(EntryList::iterator it) {
+    used -= footprint(*it);
+    index.erase(it->key);
+    order.erase(it);
+}
+
+void VictimTier::trim() {
+    while (used > budget && !order.empty()) {
+        remove(order.begin());
+    }
+}
@@ -0,0 +1,69 @@
+//
+// Ярус вытесненных блоков: чистые блоки, вытесненные из кэша, хранятся сжатыми
+// (page-cache-compress.h) в своей памяти, и промах по такому блоку обходится распаковкой
+// вместо чтения с диска. Блоки из одного повторённого байта (в том числе нулевые) хранятся
+// одним байтом. Блоки, которые сжимаются хуже VICTIM_MAX_RATIO, не хранятся.
+//
+// У каждого шарда кэша свой ярус под мьютексом шарда; бюджет памяти делится между шардами.
+// Занятая память — сжатые данные плюс VICTIM_ENTRY_OVERHEAD на запись; при превышении
+// бюджета выбрасываются самые давние записи.
+//
+
+#ifndef PAGE_CACHE_VICTIM_H
+#define PAGE_CACHE_VICTIM_H
+
+#include "page-cache-block.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+
+constexpr size_t VICTIM_ENTRY_OVERHEAD = 96;  // Служебная память записи: узлы списка и индекса
+constexpr size_t VICTIM_MAX_RATIO = 2;        // Хранятся блоки, сжатые хотя бы вдвое
+
+class VictimTier {
+public:
+    // Бюджет памяти; 0 выключает ярус. Лишние записи выбрасываются сразу
+    void set_budget(size_t bytes);
+    bool enabled() const { return budget != 0; }
+
+    // Сохранение данных чистого блока key (size байт). Возвращает true, если блок сохранён
+    bool put(const BlockKey& key, const char* data, size_t size);
+
+    // Распаковка блока key в out (size байт) с удалением записи.
+    // Возвращает false, если блока нет (или он не распаковался)
+    bool take(const BlockKey& key, char* out, size_t size);
+
+    // Удаление записи блока key (данные на диске могли измениться в обход яруса)
+    void erase(const BlockKey& key);
+
+    // Удаление всех записей файла fd (закрытие файла)
+    void erase_file(int fd);
+
+    void clear();
+
+    size_t used_bytes() const { return used; }
+    size_t blocks() const { return index.size(); }
+
+private:
+    struct Entry {
+        BlockKey key;
+        uint32_t size = 0;     // длина сжатых данных, 0 — блок из байта pattern
+        uint8_t pattern = 0;
+        std::unique_ptr<char[]> data;
+    };
+    using EntryList = std::list<Entry>;
+
+    static size_t footprint(const Entry& entry) { return entry.size + VICTIM_ENTRY_OVERHEAD; }
+    void remove(EntryList::iterator it);
+    void trim();
+
+    size_t budget = 0;
+    size_t used = 0;
+    EntryList order;  // от давних к свежим
+    std::map<BlockKey, EntryList::iterator> index;  // упорядочен, чтобы удалять записи файла диапазоном
+};
+
+#endif // PAGE_CACHE_VICTIM_H
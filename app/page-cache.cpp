@@ -3,350 +3,2376 @@
 //
 
 #include "page-cache.h"
+#include "page-cache-io.h"
+#include "page-cache-aio.h"
+#include "page-cache-block.h"
+#include "page-cache-arena.h"
+#include "page-cache-index.h"
+#include "page-cache-policy.h"
+#include "page-cache-admission.h"
+#include "page-cache-readahead.h"
+#include "page-cache-stats.h"
+#include "page-cache-trace.h"
+#include "page-cache-mmap.h"
+#include "page-cache-snapshot.h"
+#include "page-cache-victim.h"
 
-#include <windows.h>
 #include <unordered_map>
-#include <queue>
-#include <vector>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <string>
+#include <tuple>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <algorithm>
+#include <bit>
 #include <iostream>
 
-#define BLOCK_SIZE 4096       // Размер блока (4 КБ)
-#define CACHE_CAPACITY 1024 * 25  // Максимальное количество блоков в кэше (1 МБ = 256 * 1 суммарно)
+#define DEFAULT_CACHE_MEMORY (100 * 1024 * 1024)  // Память кэша по умолчанию (25600 блоков по 4 КБ)
+#define SHARD_COUNT 16            // Число шардов кэша (степень двойки)
+#define EXTENT_BLOCKS 16          // Соседние блоки одного экстента (64 КБ при блоке 4 КБ) живут в одном шарде
+#define WRITEBACK_INTERVAL_MS 1000   // Период пробуждения фоновой записи
+#define WRITEBACK_BATCH_BLOCKS 1024  // Окно фоновой записи в файле (4 МБ при блоке 4 КБ)
+#define MAX_WRITE_BYTES (1024 * 1024)  // Наибольшая запись на диск по умолчанию (1 МБ)
+#define WARM_BATCH_BLOCKS 256     // Наибольшая серия блоков тёплого старта (1 МБ при блоке 4 КБ)
+#define WARM_TIERS 4              // Ступени ранга: блоки загружаются от самых горячих к холодным
+#define GROUP_SCAN_LIMIT 32       // Сколько кандидатов политики просматривается в поисках жертвы нужной группы
+
+// Логирование
+#define DEBUG_LOG(message) /*std::cout << "[DEBUG] " << message << std::endl*/
+
+// Блоки одного файла в шарде: все находящиеся в кэше и грязные в порядке смещений.
+// Сброс файла обходит только его грязные блоки, закрытие — только его блоки
+struct FileBlocks {
+    CacheBlock* resident = nullptr;      // Список блоков файла (связан через file_prev/file_next)
+    CacheBlock* oldest = nullptr;        // Хвост списка: блок, раньше других попавший в кэш
+    size_t resident_count = 0;
+    std::map<off_t, CacheBlock*> dirty;  // Грязные блоки по смещению
+    uint8_t group = 0;                   // Группа файла (lab2_set_file_group)
+};
+
+// Шард кэша: своя часть blocks_map, своя политика вытеснения, фильтр допуска и счётчики.
+// Блок (fd, offset) всегда живёт в шарде shard_of(key). Ввод-вывод выполняется без мьютекса
+// шарда: блок на это время находится в состоянии BLOCK_LOADING/BLOCK_EVICTING или закреплён.
+// Шарду принадлежат frames блоков арены с кадрами; незанятые лежат в free_blocks.
+// Если после уменьшения кэша блоков больше capacity, освобождающиеся блоки отдают память
+// кадра ОС и уходят в retired, откуда их забирает следующий рост.
+struct CacheShard {
+    std::mutex mutex;
+    CacheBlock* free_blocks = nullptr;  // Список свободных блоков (связан через policy_next)
+    CacheBlock* retired = nullptr;      // Блоки без памяти кадра (связан через policy_next)
+    size_t capacity = 0;                // Целевое число блоков шарда
+    size_t frames = 0;                  // Блоков с кадрами: в кэше, свободных и занятых вводом-выводом
+    std::condition_variable io_done;  // Завершение ввода-вывода над каким-либо блоком шарда
+    BlockIndex blocks_map;            // Быстрый поиск блоков
+    std::unordered_map<int, FileBlocks> files;  // Блоки шарда по файлам (только непустые)
+    std::unique_ptr<EvictionPolicy> eviction_policy =  // Политика вытеснения
+        make_eviction_policy(LAB2_POLICY_S3FIFO, 0);
+    AdmissionFilter admission_filter{0};   // Фильтр допуска TinyLFU
+    VictimTier victim_tier;                // Сжатые чистые блоки, вытесненные из шарда
+    // Блоков шарда в кэше по группам. Меняются под mutex, читаются другими шардами без него
+    std::atomic<size_t> group_blocks[LAB2_MAX_GROUPS] = {};
+};
+
+// Резерв и предел памяти группы (lab2_set_group_limits), 0 у max_bytes — без предела
+struct GroupLimits {
+    std::atomic<size_t> min_bytes{0};
+    std::atomic<size_t> max_bytes{0};
+};
+
+// Открытый файл: хэндл и шаблон доступа для упреждающего чтения
+struct OpenFile {
+    io_handle_t handle;
+    size_t sector_size = MIN_SECTOR_SIZE;  // Выравнивание прямого ввода-вывода (кратно sector_unit)
+    std::mutex position_mutex;  // Сериализует lab2_read/lab2_write/lab2_lseek, как f_pos_lock ядра
+    off_t position = 0;         // Позиция файла; хранится здесь, а не в ОС, чтобы не делать lseek
+    std::atomic<off_t> size{0}; // Размер файла с учётом ещё не сброшенных записей (для SEEK_END)
+    bool has_id = false;        // Идентичность файла (io_file_id) для снимка кэша
+    uint64_t device = 0;
+    uint64_t inode = 0;
+    std::mutex readahead_mutex;
+    Readahead readahead;
+};
+
+// Глобальные структуры для управления кэшем
+std::unordered_map<int, std::shared_ptr<OpenFile>> open_files;  // Открытые файлы по дескриптору
+std::shared_mutex files_mutex;                    // Защищает open_files; не берётся под мьютексом шарда
+FrameArena frame_arena;                           // Кадры всех блоков кэша
+CacheShard shards[SHARD_COUNT];
+std::mutex config_mutex;                          // Сериализует lab2_init и lab2_resize
+std::atomic<bool> cache_ready{false};             // Кэш настроен (lab2_init или по умолчанию в lab2_open)
+std::atomic<size_t> cache_capacity{0};            // Ёмкость кэша в блоках
+std::atomic<int> eviction_policy_id{LAB2_POLICY_S3FIFO};
+bool huge_frames = false;                         // Кадры на больших страницах (под config_mutex)
+
+std::atomic<bool> admission_enabled{false};
+std::atomic<size_t> dirty_count{0};  // Грязных блоков во всём кэше
+std::atomic<size_t> max_write_bytes{MAX_WRITE_BYTES};  // Наибольшая запись на диск
+std::atomic<bool> groups_in_use{false};  // Были lab2_set_file_group или lab2_set_group_limits
+GroupLimits group_limits[LAB2_MAX_GROUPS];
+std::mutex groups_mutex;                  // Защищает file_groups; берётся и под мьютексом шарда
+std::unordered_map<int, uint8_t> file_groups;  // Группы файлов, кроме группы 0
+thread_local BlockData bypass_buffer;  // Буфер для чтения блоков, не допущенных в кэш (растёт по запросу)
+
+// Буфер bypass_buffer размером не меньше bytes
+static char* bypass_data(size_t bytes) {
+    if (bypass_buffer.size() < bytes) {
+        bypass_buffer.resize(bytes);
+    }
+    return bypass_buffer.data();
+}
+
+// Монотонное время в миллисекундах. Возраст считается вычитанием, поэтому
+// переполнение uint32_t (раз в 49 дней) не мешает
+static uint32_t now_ms() {
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Пометка секторов блока грязными и всего блока чистым с учётом dirty_count и грязных
+// блоков файла (вызывается под мьютексом шарда, блок должен быть в blocks_map)
+static void mark_dirty(CacheShard& shard, CacheBlock* block, SectorMask sectors) {
+    if (block->dirty_sectors == 0) {
+        block->dirty_since = now_ms();
+        shard.files[block->fd].dirty.emplace(block->offset, block);
+        dirty_count++;
+    }
+    block->dirty_sectors |= sectors;
+}
+
+static void mark_clean(CacheShard& shard, CacheBlock* block) {
+    if (block->dirty_sectors != 0) {
+        block->dirty_sectors = 0;
+        shard.files[block->fd].dirty.erase(block->offset);
+        dirty_count--;
+    }
+}
+
+// Группа файла fd
+static uint8_t file_group(int fd) {
+    if (!groups_in_use.load(std::memory_order_relaxed)) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(groups_mutex);
+    auto it = file_groups.find(fd);
+    return it == file_groups.end() ? 0 : it->second;
+}
+
+// Группа файла fd; если у файла есть блоки в шарде, она берётся у них (вызывается под мьютексом шарда)
+static uint8_t group_in_shard(CacheShard& shard, int fd) {
+    if (!groups_in_use.load(std::memory_order_relaxed)) {
+        return 0;
+    }
+    auto it = shard.files.find(fd);
+    return it != shard.files.end() ? it->second.group : file_group(fd);
+}
+
+// Изменение числа блоков группы в шарде (вызывается под мьютексом шарда)
+static void add_group_blocks(CacheShard& shard, uint8_t group, ptrdiff_t n) {
+    std::atomic<size_t>& blocks = shard.group_blocks[group];
+    blocks.store(blocks.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+// Блоков группы во всём кэше. Чужие шарды читаются без их мьютексов, поэтому при
+// параллельной работе число приблизительно
+static size_t group_resident(uint8_t group) {
+    size_t blocks = 0;
+    for (const CacheShard& shard : shards) {
+        blocks += shard.group_blocks[group].load(std::memory_order_relaxed);
+    }
+    return blocks;
+}
+
+static size_t group_min_blocks(uint8_t group) {
+    return group_limits[group].min_bytes.load(std::memory_order_relaxed) >> block_shift;
+}
+
+// Предел группы в блоках; не меньше одного блока, чтобы группа могла читать
+static size_t group_max_blocks(uint8_t group) {
+    size_t bytes = group_limits[group].max_bytes.load(std::memory_order_relaxed);
+    return bytes == 0 ? SIZE_MAX : std::max<size_t>(1, bytes >> block_shift);
+}
+
+// Добавление блока в blocks_map и в список блоков его файла (вызывается под мьютексом шарда)
+static void index_block(CacheShard& shard, CacheBlock* block) {
+    shard.blocks_map.insert(block_key(block), block);
+    if (shard.victim_tier.enabled()) {
+        shard.victim_tier.erase(block_key(block));  // копия в ярусе устареет с первой записью в блок
+    }
+    auto [it, inserted] = shard.files.try_emplace(block->fd);
+    FileBlocks& file = it->second;
+    if (inserted) {
+        file.group = file_group(block->fd);
+    }
+    block->group = file.group;
+    add_group_blocks(shard, block->group, 1);
+    block->file_prev = nullptr;
+    block->file_next = file.resident;
+    if (file.resident != nullptr) {
+        file.resident->file_prev = block;
+    } else {
+        file.oldest = block;
+    }
+    file.resident = block;
+    file.resident_count++;
+}
+
+// Удаление блока из blocks_map и из структур его файла (вызывается под мьютексом шарда)
+static void unindex_block(CacheShard& shard, CacheBlock* block) {
+    mark_clean(shard, block);
+    shard.blocks_map.erase(block_key(block));
+    auto it = shard.files.find(block->fd);
+    FileBlocks& file = it->second;
+    if (block->file_prev != nullptr) {
+        block->file_prev->file_next = block->file_next;
+    } else {
+        file.resident = block->file_next;
+    }
+    if (block->file_next != nullptr) {
+        block->file_next->file_prev = block->file_prev;
+    } else {
+        file.oldest = block->file_prev;
+    }
+    block->file_prev = block->file_next = nullptr;
+    add_group_blocks(shard, block->group, -1);
+    if (--file.resident_count == 0) {
+        shard.files.erase(it);
+    }
+}
+
+// Блоки файла fd в шарде или nullptr (вызывается под мьютексом шарда)
+static FileBlocks* file_blocks_of(CacheShard& shard, int fd) {
+    auto it = shard.files.find(fd);
+    return it == shard.files.end() ? nullptr : &it->second;
+}
+
+// Возврат блока в список свободных блоков шарда (вызывается под мьютексом шарда).
+// Блок уже удалён из blocks_map (unindex_block) или ещё не добавлялся туда.
+// Если у шарда блоков больше ёмкости (кэш уменьшен), память кадра возвращается ОС
+static void release_block(CacheShard& shard, CacheBlock* block) {
+    block->fd = -1;
+    block->dirty_sectors = 0;
+    block->prefetched = false;
+    block->state = BLOCK_READY;
+    block->policy_prev = nullptr;
+    if (shard.frames > shard.capacity) {
+        io_discard(block->data, block_size);
+        shard.frames--;
+        block->policy_next = shard.retired;
+        shard.retired = block;
+        return;
+    }
+    block->policy_next = shard.free_blocks;
+    shard.free_blocks = block;
+}
+
+// Выбор шарда по ключу блока. Шард определяется экстентом блока, поэтому чтение или запись
+// диапазона берёт мьютекс шарда один раз на EXTENT_BLOCKS блоков
+static CacheShard& shard_of(const BlockKey& key) {
+    uint64_t x = block_key_hash(key.first, offset_to_block(key.second) / EXTENT_BLOCKS);
+    return shards[(x >> 32) & (SHARD_COUNT - 1)];
+}
+
+// Переход к шарду shard при проходе по диапазону. Прежний мьютекс отпускается до захвата
+// нового: потоки, идущие по шардам в разном порядке, не должны держать два мьютекса сразу
+static void switch_shard(std::unique_lock<std::mutex>& lock, CacheShard*& locked, CacheShard& shard) {
+    if (locked == &shard) {
+        return;
+    }
+    if (lock.owns_lock()) {
+        lock.unlock();
+    }
+    lock = std::unique_lock<std::mutex>(shard.mutex);
+    locked = &shard;
+}
+
+// Хэндл открытого файла по дескриптору
+static bool find_handle(int fd, io_handle_t* handle) {
+    std::shared_lock<std::shared_mutex> lock(files_mutex);
+    auto it = open_files.find(fd);
+    if (it == open_files.end()) {
+        return false;
+    }
+    *handle = it->second->handle;
+    return true;
+}
+
+// Открытый файл по дескриптору или nullptr
+static std::shared_ptr<OpenFile> find_file(int fd) {
+    std::shared_lock<std::shared_mutex> lock(files_mutex);
+    auto it = open_files.find(fd);
+    return it == open_files.end() ? nullptr : it->second;
+}
+
+// Запись грязных секторов блока на диск, по вызову на серию (вызывается без мьютекса шарда)
+static bool write_block(const CacheBlock* block) {
+    io_handle_t handle;
+    if (!find_handle(block->fd, &handle)) {
+        return false;
+    }
+    bool ok = true;
+    for_each_sector_run(block->dirty_sectors, [&](size_t first, size_t sectors) {
+        size_t len = sectors * sector_unit;
+        ssize_t written = io_pwrite(handle, block->data + first * sector_unit, len, block->offset + first * sector_unit);
+        stats_add(STAT_DISK_WRITES);
+        stats_add(STAT_DISK_WRITE_BYTES, std::max<ssize_t>(written, 0));
+        ok = ok && written == static_cast<ssize_t>(len);
+    });
+    return ok;
+}
+
+// Вытеснение жертвы, выбранной политикой (вызывается под lock). Грязная жертва сначала
+// сбрасывается на диск с отпущенным lock. Если записать её не удалось, она остаётся в кэше
+// грязной, возвращается политике как только что добавленный блок, и возвращается false.
+// Полностью прочитанный блок, совпадающий с диском, сохраняется в ярусе вытесненных блоков.
+// Блок возвращается шарду через release_block
+static bool evict_block(CacheShard& shard, std::unique_lock<std::mutex>& lock, CacheBlock* victim,
+                        [[maybe_unused]] const char* caller) {
+    DEBUG_LOG(caller << ": Вытеснение блока (fd=" << victim->fd << ", offset=" << victim->offset << ") из кэша");
+    // страницы блока уходят из отображений, изменённые в них данные — в кадр
+    if (SectorMask mapped = mmap_detach_block(victim->fd, victim->offset, victim->data, true)) {
+        mark_dirty(shard, victim, mapped);
+    }
+    bool was_dirty = victim->dirty_sectors != 0;
+    if (was_dirty) {
+        DEBUG_LOG(caller << ": Сброс грязного блока (fd=" << victim->fd << ", offset=" << victim->offset << ") на диск");
+        victim->state = BLOCK_EVICTING;
+        lock.unlock();
+        bool written = write_block(victim);
+        lock.lock();
+        if (!written) {
+            DEBUG_LOG(caller << ": Не удалось записать блок (fd=" << victim->fd << ", offset=" << victim->offset << ")");
+            victim->state = BLOCK_READY;
+            shard.eviction_policy->on_insert(victim);
+            shard.io_done.notify_all();
+            return false;
+        }
+        stats_add(STAT_DIRTY_EVICTIONS);
+    }
+    if (victim->prefetched) {
+        stats_add(STAT_PREFETCH_WASTED);
+    }
+    stats_add(STAT_EVICTIONS);
+    stats_group_add(victim->group, GROUP_EVICTIONS);
+    if (shard.victim_tier.enabled() && victim->valid_sectors == all_sectors &&
+        shard.victim_tier.put(block_key(victim), victim->data, block_size)) {
+        stats_add(STAT_VICTIM_STORES);
+    }
+    unindex_block(shard, victim);
+    release_block(shard, victim);
+    if (was_dirty) {
+        shard.io_done.notify_all();
+    }
+    return true;
+}
+
+// Свободный блок шарда под ключ key или nullptr (вызывается под мьютексом шарда)
+static CacheBlock* take_free_block(CacheShard& shard, const BlockKey& key) {
+    CacheBlock* block = shard.free_blocks;
+    if (block != nullptr) {
+        shard.free_blocks = block->policy_next;
+        block->policy_next = nullptr;
+        block->fd = key.first;
+        block->offset = key.second;
+        block->valid_sectors = all_sectors;  // блок читается с диска целиком, кроме промаха записи
+    }
+    return block;
+}
+
+// Выбор жертвы для блока группы group с учётом квот (вызывается под мьютексом шарда).
+// Группа, занявшая свой предел, вытесняет только свои блоки. Иначе, если какая-то группа
+// выше предела, жертва берётся из неё, а если нет — из своей группы или из группы выше резерва.
+// Просматривается до GROUP_SCAN_LIMIT кандидатов политики, отвергнутые возвращаются на место.
+// Если среди них подходящего нет (голову очереди заняли блоки других групп), вытесняется
+// самый старый по времени попадания в кэш блок подходящей группы.
+// Возвращает nullptr, если подходящих блоков в шарде нет.
+static CacheBlock* evict_for_group(CacheShard& shard, uint8_t group) {
+    size_t resident[LAB2_MAX_GROUPS];
+    bool over[LAB2_MAX_GROUPS];
+    bool any_over = false;
+    for (uint8_t g = 0; g < LAB2_MAX_GROUPS; ++g) {
+        resident[g] = group_resident(g);
+        over[g] = resident[g] > group_max_blocks(g);
+        any_over |= over[g];
+    }
+    bool own_only = resident[group] >= group_max_blocks(group);
+    auto suitable = [&](uint8_t g) {
+        if (own_only) {
+            return g == group;
+        }
+        if (any_over) {
+            return over[g];
+        }
+        return g == group || resident[g] > group_min_blocks(g);
+    };
+
+    CacheBlock* rejected[GROUP_SCAN_LIMIT];
+    size_t count = 0;
+    CacheBlock* victim = nullptr;
+    while (count < GROUP_SCAN_LIMIT) {
+        CacheBlock* candidate = shard.eviction_policy->evict();
+        if (candidate == nullptr) {
+            break;
+        }
+        if (suitable(candidate->group)) {
+            victim = candidate;
+            break;
+        }
+        rejected[count++] = candidate;
+    }
+    // restore ставит блок в голову очереди, поэтому возвращаем в обратном порядке
+    while (count > 0) {
+        shard.eviction_policy->restore(rejected[--count]);
+    }
+    if (victim != nullptr) {
+        return victim;
+    }
+
+    for (auto& [fd, file] : shard.files) {
+        if (!suitable(file.group)) {
+            continue;
+        }
+        size_t scanned = 0;
+        for (CacheBlock* block = file.oldest; block != nullptr && scanned < GROUP_SCAN_LIMIT;
+             block = block->file_prev, ++scanned) {
+            if (block->state == BLOCK_READY && block_evictable(block)) {
+                shard.eviction_policy->on_remove(block);
+                return block;
+            }
+        }
+    }
+    return nullptr;
+}
+
+// Выделение блока под ключ key в шарде (вызывается под lock).
+// Берётся свободный блок, а если их нет — политика выбирает жертву и её кадр переиспользуется
+// (при квотах групп жертву выбирает evict_for_group). При use_admission фильтр допуска
+// может оставить жертву в кэше, тогда возвращается nullptr.
+// Грязная жертва сбрасывается на диск с отпущенным lock, поэтому вызывающий должен заново
+// проверить, не добавил ли блок key другой поток. Если все блоки шарда заняты вводом-выводом,
+// при may_wait ждём освобождения, иначе возвращаем nullptr. Жертва, которую не удалось
+// записать, остаётся в кэше, и выбирается другая; nullptr возвращается, когда неудачных
+// жертв набралось столько же, сколько блоков в шарде.
+static CacheBlock* allocate_block(CacheShard& shard, std::unique_lock<std::mutex>& lock, const BlockKey& key,
+                                  bool use_admission, bool may_wait, const char* caller) {
+    size_t failed = 0;  // жертвы, которые не удалось записать
+    for (;;) {
+        bool grouped = groups_in_use.load(std::memory_order_relaxed);
+        uint8_t group = grouped ? group_in_shard(shard, key.first) : 0;
+        // группа на пределе сначала вытесняет свой блок, даже если есть свободные
+        if (!grouped || group_resident(group) < group_max_blocks(group)) {
+            if (CacheBlock* block = take_free_block(shard, key)) {
+                return block;
+            }
+        }
+
+        CacheBlock* victim = grouped ? evict_for_group(shard, group) : nullptr;
+        if (victim == nullptr) {
+            // квоты не нашли жертвы среди первых кандидатов — свободный блок или выбор политики
+            if (CacheBlock* block = take_free_block(shard, key)) {
+                return block;
+            }
+            victim = shard.eviction_policy->evict();
+        }
+        if (victim == nullptr) {
+            if (!may_wait) {
+                return nullptr;
+            }
+            // все блоки шарда заняты вводом-выводом — ждём, пока какой-нибудь освободится
+            shard.io_done.wait(lock);
+            continue;
+        }
+        if (use_admission && admission_enabled && !shard.admission_filter.admit(key, block_key(victim))) {
+            DEBUG_LOG(caller << ": Блок (fd=" << key.first << ", offset=" << key.second << ") не допущен в кэш");
+            shard.eviction_policy->restore(victim);
+            return nullptr;
+        }
+        if (!evict_block(shard, lock, victim, caller) && ++failed >= shard.frames) {
+            DEBUG_LOG(caller << ": Не удалось освободить блок под (fd=" << key.first << ", offset=" << key.second << ")");
+            return nullptr;
+        }
+    }
+}
+
+// Распаковка блока из яруса вытесненных блоков в кадр нового блока, до index_block
+// (вызывается под мьютексом шарда). Возвращает false, если блока в ярусе нет
+static bool restore_victim(CacheShard& shard, CacheBlock* block) {
+    if (!shard.victim_tier.enabled() || !shard.victim_tier.take(block_key(block), block->data, block_size)) {
+        return false;
+    }
+    block->valid_sectors = all_sectors;
+    stats_add(STAT_VICTIM_HITS);
+    return true;
+}
+
+// Обнуление хвоста кадра за концом файла после чтения bytes байт
+static void zero_tail(char* data, ssize_t bytes, size_t size) {
+    if (bytes >= 0 && static_cast<size_t>(bytes) < size) {
+        memset(data + bytes, 0, size - bytes);
+    }
+}
+
+// Учёт обращения к блоку, найденному в кэше (вызывается под мьютексом шарда)
+static void access_block(CacheShard& shard, CacheBlock* block) {
+    if (block->prefetched) {
+        block->prefetched = false;
+        stats_add(STAT_PREFETCH_USED);
+    }
+    shard.eviction_policy->on_access(block);
+}
+
+// Поиск блока в шарде (вызывается под lock). При промахе блок добавляется в кэш: читается
+// с диска (read_from_disk) или заполняется нулями. Чтение идёт с отпущенным lock,
+// параллельные обращения к тому же блоку ждут его окончания.
+// Возвращает готовый блок (lock захвачен) или nullptr, если блок не допущен в кэш
+// фильтром (только при use_admission), под него не удалось освободить место
+// (грязные жертвы не записываются на диск) или его не удалось прочитать.
+// counted — обращение уже учтено в счётчиках попаданий/промахов.
+static CacheBlock* get_block(CacheShard& shard, std::unique_lock<std::mutex>& lock, const BlockKey& key,
+                             io_handle_t handle, bool read_from_disk, bool use_admission, const char* caller,
+                             bool counted = false) {
+    for (;;) {
+        CacheBlock* block = shard.blocks_map.find(key);
+        if (block != nullptr) {
+            if (block->state != BLOCK_READY) {
+                // блок загружается или вытесняется другим потоком — ждём окончания
+                shard.io_done.wait(lock);
+                continue;
+            }
+            if (!counted) {
+                stats_add(STAT_HITS);
+                stats_group_add(block->group, GROUP_HITS);
+            }
+            access_block(shard, block);
+            return block;
+        }
+
+        if (!counted) {
+            stats_add(STAT_MISSES);
+            stats_group_add(group_in_shard(shard, key.first), GROUP_MISSES);
+            counted = true;
+        }
+        DEBUG_LOG(caller << ": Блок (fd=" << key.first << ", offset=" << key.second << ") не найден в кэше");
+
+        // Вытеснение блока по выбору политики, если свободных блоков нет.
+        // Записи фильтр допуска не касается: данные должны попасть в кэш
+        block = allocate_block(shard, lock, key, use_admission, true, caller);
+        if (block == nullptr) {
+            return nullptr;
+        }
+        if (shard.blocks_map.contains(key)) {
+            release_block(shard, block);
+            continue; // блок добавил другой поток, пока lock был отпущен
+        }
+
+        // Добавление нового блока
+        bool restored = restore_victim(shard, block);
+        index_block(shard, block);
+        if (restored) {
+            DEBUG_LOG(caller << ": Блок (fd=" << key.first << ", offset=" << key.second << ") распакован из яруса вытесненных");
+        } else if (read_from_disk) {
+            block->state = BLOCK_LOADING;
+            lock.unlock();
+            // за концом файла блок заполняется нулями
+            ssize_t bytes = io_pread(handle, block->data, block_size, key.second);
+            zero_tail(block->data, bytes, block_size);
+            lock.lock();
+            shard.io_done.notify_all();
+            if (bytes == -1) {
+                DEBUG_LOG(caller << ": Ошибка чтения блока (fd=" << key.first << ", offset=" << key.second << ")");
+                unindex_block(shard, block);
+                release_block(shard, block);
+                return nullptr;
+            }
+            block->state = BLOCK_READY;
+        } else {
+            // промах записи: с диска читаются только секторы, которые запись задевает частично
+            memset(block->data, 0, block_size);
+            block->valid_sectors = 0;
+        }
+        shard.eviction_policy->on_insert(block);
+        DEBUG_LOG(caller << ": Блок (fd=" << key.first << ", offset=" << key.second << ") добавлен в кэш");
+        return block;
+    }
+}
+
+// Дочитывание с диска секторов блока, которые ещё не читались (блок создан промахом записи).
+// Вызывается под lock; чтение идёт с отпущенным lock, блок на это время закреплён.
+// Секторы, записанные за это время, не перезаписываются. Возвращает false при ошибке чтения
+static bool fill_block(CacheShard& shard, std::unique_lock<std::mutex>& lock, CacheBlock* block, io_handle_t handle) {
+    block->pins++;
+    lock.unlock();
+    char* disk = bypass_data(block_size);
+    ssize_t bytes = io_pread(handle, disk, block_size, block->offset);
+    zero_tail(disk, bytes, block_size);
+    lock.lock();
+    block->pins--;
+    shard.io_done.notify_all();
+    if (bytes == -1) {
+        return false;
+    }
+    for_each_sector_run(all_sectors & ~block->valid_sectors, [&](size_t first, size_t sectors) {
+        memcpy(block->data + first * sector_unit, disk + first * sector_unit, sectors * sector_unit);
+    });
+    block->valid_sectors = all_sectors;
+    return true;
+}
+
+// Ожидание окончания ввода-вывода над блоками файла в шарде (вызывается под lock)
+static void wait_file_io(CacheShard& shard, std::unique_lock<std::mutex>& lock, int fd) {
+    for (;;) {
+        bool busy = false;
+        FileBlocks* file = file_blocks_of(shard, fd);
+        for (CacheBlock* block = file ? file->resident : nullptr; block != nullptr && !busy; block = block->file_next) {
+            busy = block->state != BLOCK_READY || block->pins > 0;
+        }
+        if (!busy) {
+            return;
+        }
+        shard.io_done.wait(lock);
+    }
+}
+
+// Грязный блок, отданный на запись, и его грязные секторы на момент подготовки
+struct DirtyBlock {
+    CacheBlock* block;
+    SectorMask sectors;
+};
+
+// Подготовка грязного блока к записи (вызывается под мьютексом шарда). Блок закрепляется
+// (не вытесняется), а пометка грязных секторов снимается заранее, поэтому запись,
+// пришедшая во время сброса, снова пометит блок грязным
+static DirtyBlock claim_dirty(CacheShard& shard, CacheBlock* block) {
+    DirtyBlock claimed{block, block->dirty_sectors};
+    mark_clean(shard, block);
+    block->pins++;
+    return claimed;
+}
+
+// Участок грязных секторов одного блока (индекс блока в batch)
+struct DirtyRun {
+    size_t index;
+    off_t offset;
+    char* data;
+    size_t len;
+};
+
+// Запись подготовленных claim_dirty блоков на диск (вызывается без мьютексов шардов).
+// Пишутся только грязные секторы: блоки сортируются по смещению, и соседние серии
+// секторов файла уходят одной векторной записью не больше max_write_blocks блоков.
+// Блоки, которые не удалось записать, снова помечаются грязными; возвращается их число.
+static size_t write_back(std::vector<DirtyBlock>& batch, [[maybe_unused]] const char* caller) {
+    std::sort(batch.begin(), batch.end(), [](const DirtyBlock& a, const DirtyBlock& b) {
+        return block_key(a.block) < block_key(b.block);
+    });
+    std::vector<DirtyRun> runs;
+    for (size_t i = 0; i < batch.size(); ++i) {
+        CacheBlock* block = batch[i].block;
+        for_each_sector_run(batch[i].sectors, [&](size_t first, size_t sectors) {
+            runs.push_back({i, block->offset + static_cast<off_t>(first * sector_unit),
+                            block->data + first * sector_unit, sectors * sector_unit});
+        });
+    }
+
+    std::vector<bool> failed(batch.size());
+    std::vector<IoVec> iov;
+    size_t max_bytes = max_write_bytes;
+    for (size_t first = 0; first < runs.size();) {
+        int fd = batch[runs[first].index].block->fd;
+        size_t bytes = runs[first].len;
+        size_t end = first + 1;
+        while (end < runs.size() && end - first < IO_MAX_IOV && bytes + runs[end].len <= max_bytes &&
+               batch[runs[end].index].block->fd == fd &&
+               runs[end].offset == runs[end - 1].offset + static_cast<off_t>(runs[end - 1].len)) {
+            bytes += runs[end].len;
+            end++;
+        }
+        DEBUG_LOG(caller << ": Сброс " << bytes << " байт грязных блоков (fd=" << fd
+                  << ", offset=" << runs[first].offset << ") на диск");
+        iov.clear();
+        for (size_t i = first; i < end; ++i) {
+            iov.push_back({runs[i].data, runs[i].len});
+        }
+        ssize_t written = -1;
+        io_handle_t handle;
+        if (find_handle(fd, &handle)) {
+            written = io_pwritev(handle, iov.data(), static_cast<int>(iov.size()), runs[first].offset);
+            stats_add(STAT_DISK_WRITES);
+            stats_add(STAT_DISK_WRITE_BYTES, std::max<ssize_t>(written, 0));
+        }
+        // при частичной записи записанными считаются только целые участки
+        size_t done = std::max<ssize_t>(written, 0);
+        for (size_t i = first; i < end; ++i) {
+            if (done < runs[i].len) {
+                failed[runs[i].index] = true;
+                done = 0;
+            } else {
+                done -= runs[i].len;
+            }
+        }
+        first = end;
+    }
+
+    size_t failures = 0;
+    std::unique_lock<std::mutex> lock;
+    CacheShard* locked = nullptr;
+    for (size_t i = 0; i < batch.size(); ++i) {
+        CacheBlock* block = batch[i].block;
+        CacheShard& shard = shard_of(block_key(block));
+        if (locked != &shard && locked != nullptr) {
+            locked->io_done.notify_all();
+        }
+        switch_shard(lock, locked, shard);
+        if (failed[i]) {
+            mark_dirty(shard, block, batch[i].sectors);
+            failures++;
+        }
+        block->pins--;
+    }
+    if (locked != nullptr) {
+        locked->io_done.notify_all();
+    }
+    return failures;
+}
+
+// Сброс грязных блоков файла на диск. Блоки собираются со всех шардов, чтобы соседние
+// экстенты, лежащие в разных шардах, записались вместе
+static int flush_file(int fd, const char* caller) {
+    std::vector<DirtyBlock> dirty_blocks;
+    for (CacheShard& shard : shards) {
+        std::unique_lock<std::mutex> lock(shard.mutex);
+        // дожидаемся вытеснений и чужих сбросов, чтобы их данные тоже оказались на диске
+        wait_file_io(shard, lock, fd);
+        if (FileBlocks* file = file_blocks_of(shard, fd)) {
+            while (!file->dirty.empty()) {
+                dirty_blocks.push_back(claim_dirty(shard, file->dirty.begin()->second));
+            }
+        }
+    }
+    if (dirty_blocks.empty()) {
+        return 0;
+    }
+    return write_back(dirty_blocks, caller) > 0 ? -1 : 0;
+}
+
+// Фоновая запись грязных блоков (аналог flusher-потоков ядра). Поток просыпается раз в
+// WRITEBACK_INTERVAL_MS или по сигналу писателя и записывает блоки старше expire_ms,
+// а пока грязных блоков не меньше background_ratio % кэша — любые грязные блоки
+struct Writeback {
+    std::mutex mutex;
+    std::condition_variable wakeup;    // Будит поток записи
+    std::condition_variable progress;  // Проход записи завершён (ждут придержанные писатели)
+    std::thread thread;
+    std::once_flag started;
+    bool stopping = false;
+    bool kicked = false;
+    uint64_t passes = 0;        // Завершённых проходов
+    size_t last_written = 0;    // Блоков записано за последний проход
+
+    std::atomic<int> background_ratio{10};
+    std::atomic<int> dirty_ratio{20};
+    std::atomic<int> expire_ms{30000};
+
+    ~Writeback() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeup.notify_one();
+        progress.notify_all();
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+};
+
+Writeback writeback;
+
+// Серия блоков тёплого старта: подряд идущие блоки файла с идентичностью (device, inode)
+struct WarmBatch {
+    uint64_t device;
+    uint64_t inode;
+    uint64_t first_block;
+    size_t blocks;
+};
+
+// Тёплый старт по снимку (lab2_load_state). Фоновый поток отдаёт серии упреждающему чтению
+// в порядке pending; серии файлов, которые ещё не открыты, ждут их lab2_open
+struct WarmStart {
+    std::mutex mutex;                 // Защищает pending и kicked; files_mutex под ним не берётся
+    std::condition_variable wakeup;   // Новый снимок или открыт файл
+    std::thread thread;
+    std::once_flag started;
+    std::atomic<bool> stopping{false};
+    bool kicked = false;
+    std::vector<WarmBatch> pending;
+    std::atomic<bool> has_pending{false};
+    std::mutex close_mutex;  // Загрузка серии не пересекается с удалением блоков файла в lab2_close
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeup.notify_one();
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    ~WarmStart() { stop(); }
+};
+
+WarmStart warm_start;
+
+// Пробуждение потока тёплого старта
+static void warm_kick() {
+    {
+        std::lock_guard<std::mutex> lock(warm_start.mutex);
+        warm_start.kicked = true;
+    }
+    warm_start.wakeup.notify_one();
+}
+
+// Порог фоновой записи и порог придержания писателей в блоках
+static size_t background_limit() {
+    return cache_capacity * writeback.background_ratio / 100;
+}
+
+static size_t dirty_limit() {
+    return cache_capacity * writeback.dirty_ratio / 100;
+}
+
+// Один проход фоновой записи. Файлы обходятся окнами по WRITEBACK_BATCH_BLOCKS блоков
+// в порядке смещений; окно собирает блоки со всех шардов, поэтому соседние экстенты
+// записываются вместе. Возвращает число записанных блоков
+static size_t writeback_pass() {
+    std::vector<int> fds;
+    {
+        std::shared_lock<std::shared_mutex> lock(files_mutex);
+        for (auto& [fd, file] : open_files) {
+            fds.push_back(fd);
+        }
+    }
+
+    size_t written = 0;
+    uint32_t now = now_ms();
+    uint32_t expire = static_cast<uint32_t>(writeback.expire_ms.load());
+    std::vector<DirtyBlock> batch;
+    for (int fd : fds) {
+        off_t cursor = 0;
+        for (;;) {
+            // начало окна — первый грязный блок файла не раньше cursor
+            off_t start = -1;
+            for (CacheShard& shard : shards) {
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                if (FileBlocks* file = file_blocks_of(shard, fd)) {
+                    auto it = file->dirty.lower_bound(cursor);
+                    if (it != file->dirty.end() && (start == -1 || it->first < start)) {
+                        start = it->first;
+                    }
+                }
+            }
+            if (start == -1) {
+                break;
+            }
+            cursor = start + static_cast<off_t>(WRITEBACK_BATCH_BLOCKS) * block_size;
+
+            bool over = dirty_count >= background_limit();
+            batch.clear();
+            for (CacheShard& shard : shards) {
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                FileBlocks* file = file_blocks_of(shard, fd);
+                if (file == nullptr) {
+                    continue;
+                }
+                auto it = file->dirty.lower_bound(start);
+                while (it != file->dirty.end() && it->first < cursor) {
+                    CacheBlock* block = (it++)->second;
+                    // занятые блоки (вытеснение, чужой сброс) пропускаем
+                    if (block->state == BLOCK_READY && block->pins == 0 && (over || now - block->dirty_since >= expire)) {
+                        batch.push_back(claim_dirty(shard, block));
+                    }
+                }
+            }
+            if (!batch.empty()) {
+                written += batch.size() - write_back(batch, "writeback");
+                stats_add(STAT_WRITEBACK_BATCHES);
+            }
+        }
+    }
+    stats_add(STAT_WRITEBACK_BLOCKS, written);
+    return written;
+}
+
+static void writeback_loop() {
+    std::unique_lock<std::mutex> lock(writeback.mutex);
+    while (!writeback.stopping) {
+        writeback.wakeup.wait_for(lock, std::chrono::milliseconds(WRITEBACK_INTERVAL_MS),
+                                  [] { return writeback.kicked || writeback.stopping; });
+        if (writeback.stopping) {
+            break;
+        }
+        writeback.kicked = false;
+        lock.unlock();
+
+        // проходы повторяются, пока грязных блоков не станет меньше порога или записать нечего
+        size_t written = 0;
+        size_t pass_written;
+        do {
+            pass_written = writeback_pass();
+            written += pass_written;
+        } while (pass_written > 0 && dirty_count >= background_limit());
+
+        lock.lock();
+        writeback.passes++;
+        writeback.last_written = written;
+        writeback.progress.notify_all();
+    }
+}
+
+// Сигнал фоновой записи, если грязных блоков набралось больше порога
+static void kick_writeback() {
+    if (dirty_count < background_limit()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(writeback.mutex);
+    writeback.kicked = true;
+    writeback.wakeup.notify_one();
+}
+
+// Придержание писателя, который обогнал фоновую запись (аналог balance_dirty_pages):
+// ждём проходов записи, пока грязных блоков не станет меньше dirty_ratio % кэша.
+// Если проход ничего не записал (блоки заняты или ошибки записи), писатель отпускается
+static void throttle_writer() {
+    if (dirty_count < dirty_limit()) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(writeback.mutex);
+    while (dirty_count >= dirty_limit() && !writeback.stopping) {
+        uint64_t pass = writeback.passes;
+        writeback.kicked = true;
+        writeback.wakeup.notify_one();
+        writeback.progress.wait(lock, [&] { return writeback.passes != pass || writeback.stopping; });
+        if (writeback.last_written == 0) {
+            break;
+        }
+    }
+}
+
+// Наибольший размер одной записи на диск
+int lab2_set_max_write(size_t max_bytes) {
+    if (max_bytes < block_size) {
+        DEBUG_LOG("lab2_set_max_write: Размер меньше блока");
+        return -1;
+    }
+    max_write_bytes = max_bytes;
+    return 0;
+}
+
+// Перевод файла в группу: блоки файла, уже лежащие в кэше, перечисляются на новую группу
+int lab2_set_file_group(int fd, int group) {
+    io_handle_t handle;
+    if (group < 0 || group >= LAB2_MAX_GROUPS || !find_handle(fd, &handle)) {
+        DEBUG_LOG("lab2_set_file_group: Неверный файл или группа");
+        return -1;
+    }
+    auto new_group = static_cast<uint8_t>(group);
+    {
+        std::lock_guard<std::mutex> lock(groups_mutex);
+        if (new_group == 0) {
+            file_groups.erase(fd);
+        } else {
+            file_groups[fd] = new_group;
+        }
+        groups_in_use = true;
+    }
+    for (CacheShard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        FileBlocks* file = file_blocks_of(shard, fd);
+        if (file == nullptr || file->group == new_group) {
+            continue;
+        }
+        for (CacheBlock* block = file->resident; block != nullptr; block = block->file_next) {
+            add_group_blocks(shard, block->group, -1);
+            add_group_blocks(shard, new_group, 1);
+            block->group = new_group;
+        }
+        file->group = new_group;
+    }
+    return 0;
+}
+
+// Резерв и предел памяти группы. Уже занятая память не освобождается сразу: группа выше
+// предела отдаёт блоки по мере того, как кэшу нужны новые
+int lab2_set_group_limits(int group, size_t min_bytes, size_t max_bytes) {
+    if (group < 0 || group >= LAB2_MAX_GROUPS || (max_bytes != 0 && min_bytes > max_bytes)) {
+        DEBUG_LOG("lab2_set_group_limits: Неверная группа или лимиты");
+        return -1;
+    }
+    group_limits[group].min_bytes = min_bytes;
+    group_limits[group].max_bytes = max_bytes;
+    groups_in_use = true;
+    return 0;
+}
+
+int lab2_get_group_stats(int group, struct lab2_group_stats *stats) {
+    if (group < 0 || group >= LAB2_MAX_GROUPS || stats == nullptr) {
+        return -1;
+    }
+    stats->resident_bytes = group_resident(static_cast<uint8_t>(group)) * block_size;
+    stats->min_bytes = group_limits[group].min_bytes;
+    stats->max_bytes = group_limits[group].max_bytes;
+    stats_collect_group(static_cast<uint8_t>(group), stats, false);
+    return 0;
+}
+
+// Память яруса вытесненных блоков делится поровну между шардами
+int lab2_set_victim_tier(size_t memory_bytes) {
+    for (CacheShard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.victim_tier.set_budget(memory_bytes / SHARD_COUNT);
+    }
+    return 0;
+}
+
+// Параметры фоновой записи
+int lab2_set_writeback(int background_ratio, int dirty_ratio, int expire_ms) {
+    if (background_ratio <= 0 || background_ratio > dirty_ratio || dirty_ratio > 100 || expire_ms <= 0) {
+        DEBUG_LOG("lab2_set_writeback: Неверные параметры");
+        return -1;
+    }
+    writeback.background_ratio = background_ratio;
+    writeback.dirty_ratio = dirty_ratio;
+    writeback.expire_ms = expire_ms;
+    return 0;
+}
+
+// Выбор политики вытеснения
+int lab2_set_eviction_policy(int policy) {
+    {
+        std::shared_lock<std::shared_mutex> lock(files_mutex);
+        if (!open_files.empty()) {
+            DEBUG_LOG("lab2_set_eviction_policy: Есть открытые файлы, смена политики невозможна");
+            return -1;
+        }
+    }
+    for (CacheShard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (!shard.blocks_map.empty()) {
+            DEBUG_LOG("lab2_set_eviction_policy: Кэш не пуст, смена политики невозможна");
+            return -1;
+        }
+        std::unique_ptr<EvictionPolicy> new_policy = make_eviction_policy(policy, shard.capacity);
+        if (!new_policy) {
+            DEBUG_LOG("lab2_set_eviction_policy: Неизвестная политика " << policy);
+            return -1;
+        }
+        shard.eviction_policy = std::move(new_policy);
+    }
+    eviction_policy_id = policy;
+    return 0;
+}
+
+// Включение фильтра допуска
+int lab2_set_admission_filter(int enabled) {
+    admission_enabled = enabled != 0;
+    return 0;
+}
+
+// Ёмкость шарда index при ёмкости кэша capacity блоков
+static size_t shard_capacity(size_t capacity, size_t index) {
+    return capacity / SHARD_COUNT + (index < capacity % SHARD_COUNT ? 1 : 0);
+}
+
+// Изменение ёмкости кэша на ходу (вызывается под config_mutex, без мьютексов шардов).
+// Рост сначала возвращает в работу блоки, отдавшие память при прошлом уменьшении, затем
+// добавляет сегмент арены. Уменьшение отдаёт ОС память свободных блоков и вытесняет лишние
+// (грязные записываются на диск); блоки, занятые вводом-выводом или выданные
+// lab2_get_page, отдадут память, когда освободятся. Возвращает false, если памяти не хватило
+static bool resize_cache(size_t capacity) {
+    size_t missing = 0;
+    for (size_t i = 0; i < SHARD_COUNT; ++i) {
+        CacheShard& shard = shards[i];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.capacity = shard_capacity(capacity, i);
+        while (shard.frames < shard.capacity && shard.retired != nullptr) {
+            CacheBlock* block = shard.retired;
+            shard.retired = block->policy_next;
+            shard.frames++;
+            release_block(shard, block);
+        }
+        missing += shard.capacity - std::min(shard.frames, shard.capacity);
+        shard.eviction_policy->set_capacity(shard.capacity);
+        shard.admission_filter = AdmissionFilter(shard.capacity);
+    }
+
+    CacheBlock* added = missing > 0 ? frame_arena.grow(missing, huge_frames) : nullptr;
+    size_t total = 0;
+    for (CacheShard& shard : shards) {
+        std::unique_lock<std::mutex> lock(shard.mutex);
+        if (shard.frames < shard.capacity) {
+            if (added == nullptr) {
+                // память не выделена: шард остаётся при своих блоках
+                shard.capacity = shard.frames;
+                shard.eviction_policy->set_capacity(shard.capacity);
+            }
+            while (added != nullptr && shard.frames < shard.capacity) {
+                shard.frames++;
+                release_block(shard, added++);
+            }
+        }
+        while (shard.frames > shard.capacity) {
+            if (CacheBlock* block = shard.free_blocks) {
+                shard.free_blocks = block->policy_next;
+                release_block(shard, block);
+                continue;
+            }
+            CacheBlock* victim = shard.eviction_policy->evict();
+            if (victim == nullptr) {
+                break;  // остальные блоки заняты
+            }
+            if (!evict_block(shard, lock, victim, "lab2_resize")) {
+                break;  // грязный блок не удалось записать, он остаётся в кэше
+            }
+        }
+        total += shard.capacity;
+    }
+    cache_capacity = total;
+    DEBUG_LOG("lab2_resize: Ёмкость кэша " << total << " блоков");
+    return total == capacity;
+}
+
+// Настройка пустого кэша: размер блока, ёмкость и память кадров (вызывается под config_mutex)
+static bool init_cache(size_t capacity, size_t new_block_size, bool huge) {
+    for (CacheShard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.free_blocks = nullptr;
+        shard.retired = nullptr;
+        shard.frames = 0;
+        shard.capacity = 0;
+        shard.victim_tier.clear();  // размер блока может смениться
+    }
+    frame_arena.clear();
+    set_block_geometry(new_block_size);
+    huge_frames = huge;
+    for (size_t i = 0; i < SHARD_COUNT; ++i) {
+        CacheShard& shard = shards[i];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.blocks_map = BlockIndex(shard_capacity(capacity, i));
+        shard.eviction_policy = make_eviction_policy(eviction_policy_id, shard_capacity(capacity, i));
+    }
+    return resize_cache(capacity);
+}
+
+// Настройка кэша по умолчанию, если lab2_init не вызывался
+static bool ensure_cache() {
+    if (cache_ready.load(std::memory_order_acquire)) {
+        return true;
+    }
+    std::lock_guard<std::mutex> lock(config_mutex);
+    if (!cache_ready && init_cache(DEFAULT_CACHE_MEMORY / MIN_BLOCK_SIZE, MIN_BLOCK_SIZE, false)) {
+        cache_ready = true;
+    }
+    return cache_ready;
+}
+
+// Начальная настройка кэша
+int lab2_init(const struct lab2_config *config) {
+    size_t memory = config != nullptr && config->memory_bytes != 0 ? config->memory_bytes : DEFAULT_CACHE_MEMORY;
+    size_t new_block_size = config != nullptr && config->block_size != 0 ? config->block_size : MIN_BLOCK_SIZE;
+    if (new_block_size < MIN_BLOCK_SIZE || new_block_size > MAX_BLOCK_SIZE || !std::has_single_bit(new_block_size) ||
+        memory / new_block_size < SHARD_COUNT) {
+        DEBUG_LOG("lab2_init: Неверные параметры");
+        return -1;
+    }
+    std::lock_guard<std::mutex> config_lock(config_mutex);
+    {
+        std::shared_lock<std::shared_mutex> lock(files_mutex);
+        if (!open_files.empty()) {
+            DEBUG_LOG("lab2_init: Есть открытые файлы, настройка невозможна");
+            return -1;
+        }
+    }
+    for (CacheShard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (!shard.blocks_map.empty()) {
+            DEBUG_LOG("lab2_init: Кэш не пуст, настройка невозможна");
+            return -1;
+        }
+    }
+    // при нехватке памяти кэш остаётся ненастроенным, lab2_open попробует настройки по умолчанию
+    bool huge = config != nullptr && config->huge_pages != 0;
+    cache_ready = init_cache(memory / new_block_size, new_block_size, huge);
+    return cache_ready ? 0 : -1;
+}
+
+// Изменение объёма памяти кэша
+int lab2_resize(size_t memory_bytes) {
+    std::lock_guard<std::mutex> config_lock(config_mutex);
+    size_t capacity = memory_bytes / block_size;
+    if (capacity < SHARD_COUNT) {
+        DEBUG_LOG("lab2_resize: Слишком маленький объём памяти");
+        return -1;
+    }
+    if (!cache_ready) {
+        cache_ready = init_cache(capacity, block_size, huge_frames);
+        return cache_ready ? 0 : -1;
+    }
+    return resize_cache(capacity) ? 0 : -1;
+}
+
+// Открытие файла
+int lab2_open(const char *path) {
+    return lab2_open_flags(path, LAB2_OPEN_CREATE | LAB2_OPEN_TRUNCATE);
+}
+
+// Открытие файла с флагами LAB2_OPEN_*
+int lab2_open_flags(const char *path, int flags) {
+    DEBUG_LOG("lab2_open: Открытие файла " << path << ", флаги " << flags);
+    if (!ensure_cache()) {
+        DEBUG_LOG("lab2_open: Не удалось выделить память кэша");
+        return -1;
+    }
+    IoOpenMode mode;
+    if (flags & LAB2_OPEN_CREATE) {
+        mode = (flags & LAB2_OPEN_EXCLUSIVE) ? IO_CREATE_NEW
+             : (flags & LAB2_OPEN_TRUNCATE)  ? IO_CREATE_ALWAYS
+                                             : IO_OPEN_ALWAYS;
+    } else {
+        mode = (flags & LAB2_OPEN_TRUNCATE) ? IO_TRUNCATE_EXISTING : IO_OPEN_EXISTING;
+    }
+    // открытие в обход кэша ОС (см. page-cache-io-*.cpp)
+    io_handle_t hFile;
+    if (!io_open(path, mode, &hFile)) {
+        DEBUG_LOG("lab2_open: Ошибка открытия файла " << path);
+        return -1;
+    }
+
+    auto file = std::make_shared<OpenFile>();
+    file->handle = hFile;
+    file->sector_size = std::clamp<size_t>(io_sector_size(hFile), sector_unit, block_size);
+    file->size = std::max<off_t>(io_seek(hFile, 0, SEEK_END), 0);
+    file->has_id = io_file_id(hFile, &file->device, &file->inode);
+    std::call_once(writeback.started, [] { writeback.thread = std::thread(writeback_loop); });
+    // трассу можно включить без изменения программы: LAB2_TRACE=путь
+    static std::once_flag trace_from_env;
+    std::call_once(trace_from_env, [] {
+        const char* trace_path = getenv("LAB2_TRACE");
+        if (trace_path != nullptr && *trace_path != '\0' && !trace_enabled) {
+            trace_start(trace_path);
+        }
+    });
+
+    std::unique_lock<std::shared_mutex> lock(files_mutex);
+    int fd = io_handle_to_fd(hFile);
+    open_files[fd] = file;
+    if (warm_start.has_pending) {
+        warm_kick();  // снимок мог ждать этот файл
+    }
+    trace_record(TRACE_OPEN, fd);
+    DEBUG_LOG("lab2_open: Файл открыт, fd=" << fd);
+    return fd;
+}
+
+// Закрытие файла
+int lab2_close(int fd) {
+    DEBUG_LOG("lab2_close: Закрытие файла с fd=" << fd);
+    io_handle_t handle;
+    if (!find_handle(fd, &handle)) {
+        DEBUG_LOG("lab2_close: Файл с fd=" << fd << " не найден");
+        return -1;
+    }
+
+    if (mmap_in_use(fd)) {
+        DEBUG_LOG("lab2_close: У файла с fd=" << fd << " есть отображения в память");
+        return -1;
+    }
+
+    // Выданные пользователю страницы должны быть возвращены до закрытия
+    for (CacheShard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        FileBlocks* file = file_blocks_of(shard, fd);
+        for (CacheBlock* block = file ? file->resident : nullptr; block != nullptr; block = block->file_next) {
+            if (block->page_refs > 0) {
+                DEBUG_LOG("lab2_close: Страница (fd=" << fd << ", offset=" << block->offset << ") не возвращена");
+                return -1;
+            }
+        }
+    }
+
+    // Сброс всех "грязных" блоков на диск. Если он не удался, файл остаётся открытым
+    if (flush_file(fd, "lab2_close") != 0) {
+        DEBUG_LOG("lab2_close: Не удалось сбросить грязные блоки файла с fd=" << fd);
+        return -1;
+    }
+
+    // Удаление всех блоков, связанных с файлом. Тёплый старт не загружает блоки файла
+    // с этого момента и до удаления из open_files
+    std::lock_guard<std::mutex> warm_lock(warm_start.close_mutex);
+    std::vector<CacheBlock*> file_blocks;
+    for (CacheShard& shard : shards) {
+        std::unique_lock<std::mutex> lock(shard.mutex);
+        for (;;) {
+            wait_file_io(shard, lock, fd);
+            FileBlocks* file = file_blocks_of(shard, fd);
+            if (file == nullptr || file->dirty.empty()) {
+                break;
+            }
+            // блоки изменены параллельной записью уже после сброса: пишем их с отпущенным lock
+            std::vector<DirtyBlock> late;
+            while (!file->dirty.empty()) {
+                late.push_back(claim_dirty(shard, file->dirty.begin()->second));
+            }
+            lock.unlock();
+            size_t failures = write_back(late, "lab2_close");
+            lock.lock();
+            if (failures > 0) {
+                DEBUG_LOG("lab2_close: Не удалось сбросить грязные блоки файла с fd=" << fd);
+                return -1;
+            }
+        }
+        // список блоков файла меняется при удалении, поэтому сначала собираем блоки
+        file_blocks.clear();
+        FileBlocks* file = file_blocks_of(shard, fd);
+        for (CacheBlock* block = file ? file->resident : nullptr; block != nullptr; block = block->file_next) {
+            file_blocks.push_back(block);
+        }
+        for (CacheBlock* block : file_blocks) {
+            DEBUG_LOG("lab2_close: Удаление блока (fd=" << fd << ", offset=" << block->offset << ") из кэша");
+            // блок возвращается в список свободных блоков шарда, кадр остаётся в арене
+            shard.eviction_policy->on_remove(block);
+            unindex_block(shard, block);
+            release_block(shard, block);
+        }
+        // дескриптор достанется другому файлу: сжатые копии его блоков больше не верны
+        shard.victim_tier.erase_file(fd);
+    }
+    // закрытие пишется в трассу, только когда файл точно закрывается: после неудачи
+    // программа продолжает работать с тем же fd
+    trace_record(TRACE_CLOSE, fd);
+
+    if (groups_in_use) {
+        std::lock_guard<std::mutex> groups_lock(groups_mutex);
+        file_groups.erase(fd);
+    }
 
-// Логирование
-#define DEBUG_LOG(message) /*std::cout << "[DEBUG] " << message << std::endl*/
+    std::unique_lock<std::shared_mutex> lock(files_mutex);
+    auto it = open_files.find(fd); // итератор на результат поиска
+    if (it == open_files.end()) {
+        return -1;
+    }
+    // прямой ввод-вывод записывает последний сектор целиком: отрезаем его хвост за концом файла.
+    // Файл длиннее на целый сектор и больше дописан в обход кэша — его не трогаем
+    off_t size = it->second->size;
+    off_t disk_size = io_seek(it->second->handle, 0, SEEK_END);
+    off_t unit = static_cast<off_t>(it->second->sector_size);
+    if (disk_size > size && disk_size <= (size + unit - 1) / unit * unit) {
+        io_truncate(it->second->handle, size);
+    }
+    io_close(it->second->handle); // закрыли файл по хэндлу
+    open_files.erase(it); // удалили файл из списка открытых
+    DEBUG_LOG("lab2_close: Файл с fd=" << fd << " успешно закрыт");
+    return 0;
+}
+
+// Копирование пересечения блока [block_offset, block_offset + block_size) с диапазоном
+// [pos, pos + count) из данных блока в буфер диапазона
+static void copy_from_block(char* buf, off_t pos, size_t count, off_t block_offset, const char* data) {
+    off_t from = std::max(pos, block_offset);
+    off_t to = std::min(static_cast<off_t>(pos + count), block_offset + static_cast<off_t>(block_size));
+    memcpy(buf + (from - pos), data + (from - block_offset), to - from);
+}
 
-// Структура блока кэша
-struct CacheBlock {
-    int fd;                  // Дескриптор файла
-    off_t offset;            // Смещение блока в файле
-    std::vector<char> data;  // Данные блока (4 КБ)
-    bool dirty;              // Флаг "грязного" блока
+// Блок, который читает с диска текущий вызов read_range
+struct LoadingBlock {
+    off_t offset;
+    CacheBlock* block;  // nullptr — блок не допущен в кэш и читается в bypass_buffer
+    size_t bypass_slot;
 };
 
-// Хэш-функция для пары (fd, offset)
-struct PairHash {
-    // метод-оператор, вызывается по умолчанию для объекта при использовании его как функции
-    // функтор (функциональный объект)
-    size_t operator()(const std::pair<int, off_t>& p) const {
-        return std::hash<int>()(p.first) ^ std::hash<off_t>()(p.second);
+// Данные блока loading[i]: кадр блока или слот в буфере bypass
+static char* loading_data(const LoadingBlock& loading, char* bypass) {
+    return loading.block ? loading.block->data : bypass + loading.bypass_slot * block_size;
+}
+
+// Конец непрерывной серии блоков loading, начинающейся с run_start (не длиннее IO_MAX_IOV)
+static size_t run_end_of(const std::vector<LoadingBlock>& loading, size_t run_start) {
+    size_t run_end = run_start + 1;
+    while (run_end < loading.size() && run_end - run_start < IO_MAX_IOV &&
+           loading[run_end].offset == loading[run_end - 1].offset + static_cast<off_t>(block_size)) {
+        run_end++;
     }
-};
+    return run_end;
+}
 
-// Глобальные структуры для управления кэшем
-std::unordered_map<int, HANDLE> open_files;  // Дескрипторы файлов
-std::queue<CacheBlock*> fifo_queue;          // Очередь для FIFO
-std::unordered_map<std::pair<int, off_t>, CacheBlock*, PairHash> blocks_map; // Быстрый поиск блоков
-std::mutex cache_mutex;                      // Мьютекс для потокобезопасности
+// Буферы серии [run_start, run_end) для векторного чтения
+static std::vector<IoVec> run_iov(const std::vector<LoadingBlock>& loading, char* bypass,
+                                  size_t run_start, size_t run_end) {
+    std::vector<IoVec> iov;
+    for (size_t i = run_start; i < run_end; ++i) {
+        iov.push_back({loading_data(loading[i], bypass), block_size});
+    }
+    return iov;
+}
 
-int cache_hit = 0;
-int cache_miss = 0;
-std::mutex count_mutex;
+// Разбор результата чтения серии: bytes байт от её начала или -1. В loaded[i] — сколько байт
+// блока i прочитано (0 — блок целиком за концом файла) или -1; хвост за концом файла обнуляется
+static void finish_run(const std::vector<LoadingBlock>& loading, char* bypass, size_t run_start,
+                       size_t run_end, ssize_t bytes, ssize_t* loaded) {
+    for (size_t i = run_start; i < run_end; ++i) {
+        ssize_t block_bytes = bytes == -1 ? -1
+            : std::clamp<ssize_t>(bytes - static_cast<ssize_t>((i - run_start) * block_size), 0, block_size);
+        zero_tail(loading_data(loading[i], bypass), block_bytes, block_size);
+        loaded[i] = block_bytes;
+    }
+}
 
-// Открытие файла
-int lab2_open(const char *path) {
-    DEBUG_LOG("lab2_open: Открытие файла " << path);
-    HANDLE hFile = CreateFileA(
-        path, // путь к файлу
-        GENERIC_READ | GENERIC_WRITE, // доступ к чтению/ записи
-        0, // режим совместного доступа (тут эксклюзивный)
-        NULL, // атрибуты безопасности (тут по умолчанию)
-        CREATE_ALWAYS, // OPEN_EXISTING : открывается, если существует. ошибка, если нет
-        FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH,  // обход кэша ОС // TODO: флаги
-        NULL // шаблон файла (тут не используется)
-    );
-    if (hFile == INVALID_HANDLE_VALUE) {
-        DEBUG_LOG("lab2_open: Ошибка открытия файла " << path);
-        return -1;
+// Чтение блоков loading (упорядочены по смещению) одним векторным чтением на непрерывную
+// серию, результат по блокам — в loaded (см. finish_run). Одна серия читается в вызывающем
+// потоке; несколько серий отправляются движку асинхронного ввода-вывода разом и читаются
+// параллельно, вызывающий поток ждёт последнюю
+static void read_runs(io_handle_t handle, const std::vector<LoadingBlock>& loading, char* bypass,
+                      std::vector<ssize_t>& loaded) {
+    loaded.assign(loading.size(), 0);
+    if (loading.empty()) {
+        return;
+    }
+    std::vector<std::pair<size_t, size_t>> runs;
+    for (size_t run_start = 0; run_start < loading.size(); run_start = runs.back().second) {
+        runs.emplace_back(run_start, run_end_of(loading, run_start));
     }
 
-    std::lock_guard<std::mutex> lock(cache_mutex);
-    // HANDLE -> intptr_t -> int
-    int fd = static_cast<int>(reinterpret_cast<intptr_t>(hFile));
-    open_files[fd] = hFile;
-    DEBUG_LOG("lab2_open: Файл открыт, fd=" << fd);
-    // cache_mutex.unlock(); // избыточно (?)
-    return fd;
+    if (runs.size() == 1) {
+        std::vector<IoVec> iov = run_iov(loading, bypass, 0, loading.size());
+        ssize_t bytes = io_preadv(handle, iov.data(), static_cast<int>(iov.size()), loading[0].offset);
+        finish_run(loading, bypass, 0, loading.size(), bytes, loaded.data());
+        return;
+    }
+
+    std::mutex mutex;
+    std::condition_variable runs_done;
+    size_t pending = runs.size();
+    for (auto [run_start, run_end] : runs) {
+        std::vector<IoVec> iov = run_iov(loading, bypass, run_start, run_end);
+        io_engine().submit_read(handle, iov.data(), static_cast<int>(iov.size()), loading[run_start].offset,
+            [&, run_start, run_end](ssize_t bytes) {
+                finish_run(loading, bypass, run_start, run_end, bytes, loaded.data());
+                // уведомление под мьютексом: после него ожидающий поток может уничтожить runs_done
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--pending == 0) {
+                    runs_done.notify_one();
+                }
+            });
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    runs_done.wait(lock, [&] { return pending == 0; });
 }
 
-// Закрытие файла
-int lab2_close(int fd) {
-    DEBUG_LOG("lab2_close: Закрытие файла с fd=" << fd);
-    std::lock_guard<std::mutex> lock(cache_mutex);
-    auto it = open_files.find(fd); // итератор на результат поиска
-    if (it == open_files.end()) {
-        DEBUG_LOG("lab2_close: Файл с fd=" << fd << " не найден");
+// Чтение диапазона [pos, pos + count) через кэш.
+// 1. За один проход по блокам диапазона (мьютекс шарда — раз на экстент) попадания копируются
+//    сразу, под промахи резервируются блоки в состоянии BLOCK_LOADING.
+// 2. Каждая непрерывная серия промахов читается одним io_preadv прямо в данные блоков.
+// 3. Загруженные блоки становятся BLOCK_READY и копируются в буфер.
+// 4. Блоки, которые в первом проходе загружал или вытеснял другой поток, дочитываются по одному.
+//    Ждать их можно только здесь, когда свои резервы уже сняты: иначе два потока с
+//    пересекающимися диапазонами могли бы ждать друг друга.
+static ssize_t read_range(int fd, io_handle_t handle, char* buf, size_t count, off_t pos) {
+    if (count == 0) {
+        return 0;
+    }
+    // зануляем младшие биты (block_size - степень двойки). выравниваем, что читать
+    off_t first_offset = block_start(pos);
+    off_t end = pos + count;
+
+    std::vector<LoadingBlock> loading;
+    std::vector<off_t> deferred;
+    size_t bypass_slots = 0;
+
+    // 1. Поиск блоков диапазона в кэше
+    {
+        std::unique_lock<std::mutex> lock;
+        CacheShard* locked = nullptr;
+        for (off_t offset = first_offset; offset < end; offset += block_size) {
+            auto key = std::make_pair(fd, offset);
+            CacheShard& shard = shard_of(key);
+            switch_shard(lock, locked, shard);
+            shard.admission_filter.record(key);
+
+            CacheBlock* cached = shard.blocks_map.find(key);
+            if (cached != nullptr) {
+                // недочитанный блок (после промаха записи) дочитывается в шаге 4
+                if (cached->state != BLOCK_READY || cached->valid_sectors != all_sectors) {
+                    deferred.push_back(offset);
+                    continue;
+                }
+                stats_add(STAT_HITS);
+                stats_group_add(cached->group, GROUP_HITS);
+                access_block(shard, cached);
+                copy_from_block(buf, pos, count, offset, cached->data);
+                continue;
+            }
+
+            stats_add(STAT_MISSES);
+            stats_group_add(group_in_shard(shard, key.first), GROUP_MISSES);
+            DEBUG_LOG("lab2_read: Блок (fd=" << fd << ", offset=" << offset << ") не найден в кэше, загрузка с диска");
+            // ждать освобождения блоков нельзя: свои резервы этого шарда уже держим
+            CacheBlock* block = allocate_block(shard, lock, key, true, false, "lab2_read");
+            if (block == nullptr) {
+                // Блок не допущен в кэш или шард занят вводом-выводом: читаем его в обход кэша
+                loading.push_back({offset, nullptr, bypass_slots++});
+                continue;
+            }
+            if (shard.blocks_map.contains(key)) {
+                // блок добавил другой поток, пока lock был отпущен
+                release_block(shard, block);
+                deferred.push_back(offset);
+                continue;
+            }
+            if (restore_victim(shard, block)) {
+                index_block(shard, block);
+                shard.eviction_policy->on_insert(block);
+                copy_from_block(buf, pos, count, offset, block->data);
+                continue;
+            }
+            block->state = BLOCK_LOADING;
+            index_block(shard, block);
+            loading.push_back({offset, block, 0});
+        }
+    }
+
+    // 2. Чтение непрерывных серий промахов одним вызовом на серию
+    char* bypass = bypass_data(bypass_slots * block_size);
+    std::vector<ssize_t> loaded;
+    read_runs(handle, loading, bypass, loaded);
+
+    // 3. Публикация загруженных блоков
+    bool error = false;
+    {
+        std::unique_lock<std::mutex> lock;
+        CacheShard* locked = nullptr;
+        for (size_t i = 0; i < loading.size(); ++i) {
+            bool failed = loaded[i] == -1;
+            if (failed) {
+                error = true;
+            }
+            CacheBlock* block = loading[i].block;
+            if (block == nullptr) {
+                copy_from_block(buf, pos, count, loading[i].offset, loading_data(loading[i], bypass));
+                continue;
+            }
+            CacheShard& shard = shard_of(block_key(block));
+            if (locked != &shard && locked) {
+                locked->io_done.notify_all();
+            }
+            switch_shard(lock, locked, shard);
+            if (failed) {
+                // ошибка чтения: блок не остаётся в кэше
+                unindex_block(shard, block);
+                release_block(shard, block);
+                continue;
+            }
+            block->state = BLOCK_READY;
+            shard.eviction_policy->on_insert(block);
+            copy_from_block(buf, pos, count, block->offset, block->data);
+            DEBUG_LOG("lab2_read: Блок (fd=" << fd << ", offset=" << block->offset << ") добавлен в кэш");
+        }
+        if (locked) {
+            locked->io_done.notify_all();
+        }
+    }
+    if (error) {
         return -1;
     }
 
-    // Сброс всех "грязных" блоков на диск
-    for (auto& pair : blocks_map) {
-        // проверка принадлежности блоков нашему файлу и проверка флага dirty
-        if (pair.first.first == fd && pair.second->dirty) {
-            DEBUG_LOG("lab2_close: Сброс грязного блока (fd=" << fd << ", offset=" << pair.second->offset << ") на диск");
-            // 64 бита число из windows api
-            LARGE_INTEGER pos;
-            // число целиком по QuadPart становится равным offset из CacheBlock
-            pos.QuadPart = pair.second->offset;
-            // 1. из итератора берем значение HANDLE, 2. куда смещаемся, 3. куда сохраняем, 4. как смещаемся
-            SetFilePointerEx(it->second, pos, NULL, FILE_BEGIN);
-            // сколько записали байт
-            DWORD written;
-            // 1. HANDLE, 2. что пишем, 3. сколько пишем, 4. сколько записали, 5. ??? структура для асинхронных операций
-            WriteFile(it->second, pair.second->data.data(), BLOCK_SIZE, &written, NULL);
-            pair.second->dirty = false;
-        }
-    }
-
-    // Удаление всех блоков, связанных с файлом
-    auto block_it = blocks_map.begin();
-    while (block_it != blocks_map.end()) {
-        // проверка на файл
-        if (block_it->first.first == fd) {
-            DEBUG_LOG("lab2_close: Удаление блока (fd=" << fd << ", offset=" << block_it->second->offset << ") из кэша");
-            // с помощью delete освобождается память, выделенная под блок
-            // под блоки выделяется память в куче, но она не освобождается сама по себе
-            delete block_it->second;
-            block_it = blocks_map.erase(block_it); // из мэпы удаляется блок, возвращается итератор на следующий
-        } else {
-            ++block_it;
+    // 4. Блоки, занятые другими потоками
+    for (off_t offset : deferred) {
+        auto key = std::make_pair(fd, offset);
+        CacheShard& shard = shard_of(key);
+        std::unique_lock<std::mutex> lock(shard.mutex);
+        CacheBlock* block = get_block(shard, lock, key, handle, true, true, "lab2_read");
+        if (block == nullptr) {
+            lock.unlock();
+            char* disk = bypass_data(block_size);
+            ssize_t bytes = io_pread(handle, disk, block_size, offset);
+            if (bytes == -1) {
+                return -1;
+            }
+            zero_tail(disk, bytes, block_size);
+            copy_from_block(buf, pos, count, offset, disk);
+            continue;
         }
+        if (block->valid_sectors != all_sectors && !fill_block(shard, lock, block, handle)) {
+            return -1;
+        }
+        copy_from_block(buf, pos, count, offset, block->data);
     }
 
-    CloseHandle(it->second); // закрыли файл по HANDLE
-    open_files.erase(it); // удалили файл из списка открытых
-    DEBUG_LOG("lab2_close: Файл с fd=" << fd << " успешно закрыт");
-    return 0;
+    DEBUG_LOG("lab2_read: Прочитано " << count << " байт (fd=" << fd << ", offset=" << pos << ")");
+    return count;
 }
 
-// Чтение данных
-ssize_t lab2_read(int fd, void *buf, size_t count) {
-    DEBUG_LOG("lab2_read: Чтение из файла с fd=" << fd << ", count=" << count);
-    std::lock_guard<std::mutex> lock(cache_mutex);
-    auto it = open_files.find(fd);
-    if (it == open_files.end()) {
-        DEBUG_LOG("lab2_read: Файл с fd=" << fd << " не найден");
-        return -1;
+// Публикация блоков, загруженных упреждающим чтением (вызывается в потоке движка
+// асинхронного ввода-вывода). Блоки с ошибкой чтения и за концом файла в кэш не попадают
+static void publish_prefetched(const std::vector<LoadingBlock>& loading, const std::vector<ssize_t>& loaded) {
+    std::unique_lock<std::mutex> lock;
+    CacheShard* locked = nullptr;
+    for (size_t i = 0; i < loading.size(); ++i) {
+        CacheBlock* block = loading[i].block;
+        CacheShard& shard = shard_of(block_key(block));
+        if (locked != &shard && locked) {
+            locked->io_done.notify_all();
+        }
+        switch_shard(lock, locked, shard);
+        if (loaded[i] <= 0) {
+            unindex_block(shard, block);
+            release_block(shard, block);
+            continue;
+        }
+        block->state = BLOCK_READY;
+        block->prefetched = true;
+        stats_add(STAT_PREFETCH_ISSUED);
+        shard.eviction_policy->on_insert(block);
+    }
+    if (locked) {
+        locked->io_done.notify_all();
     }
+}
 
-    // Получаем текущую позицию в файле
-    // что читаем
-    off_t current_pos = lab2_lseek(fd, 0, SEEK_CUR);
-    if (current_pos == -1) {
-        DEBUG_LOG("lab2_read: Ошибка получения текущей позиции файла");
-        return -1;
-    }
-
-    // BLOCK_SIZE - 1 = 4096 - 1 = 4095 = 0b1111_1111_1111 = 0b0000_0000_0000_0000_0000_1111_1111_1111
-    // ~(...) = 0b1111_1111_1111_1111_1111_0000_0000_0000
-    // зануляем младшие биты. выравниваем, что читать
-    off_t aligned_offset = current_pos & ~(BLOCK_SIZE - 1);
-
-    // Поиск блока в кэше
-    // создаем пару для поиска (она будет захэширована)
-    auto key = std::make_pair(fd, aligned_offset);
-    auto block_it = blocks_map.find(key);
-    if (block_it == blocks_map.end()) {
-        std::lock_guard<std::mutex> lock(count_mutex);
-        cache_miss++;
-        DEBUG_LOG("lab2_read: Блок (fd=" << fd << ", offset=" << aligned_offset << ") не найден в кэше, загрузка с диска");
-        CacheBlock* new_block = new CacheBlock{fd, aligned_offset, std::vector<char>(BLOCK_SIZE), false};
-        LARGE_INTEGER pos;
-        pos.QuadPart = aligned_offset;
-        SetFilePointerEx(it->second, pos, NULL, FILE_BEGIN);
-        DWORD bytes_read;
-        ReadFile(it->second, new_block->data.data(), BLOCK_SIZE, &bytes_read, NULL);
-
-        // Вытеснение старого блока, если кэш заполнен
-        if (blocks_map.size() >= CACHE_CAPACITY) {
-            CacheBlock* oldest = fifo_queue.front();
-            DEBUG_LOG("lab2_read: Вытеснение блока (fd=" << oldest->fd << ", offset=" << oldest->offset << ") из кэша");
-            if (oldest->dirty) {
-                DEBUG_LOG("lab2_read: Сброс грязного блока (fd=" << oldest->fd << ", offset=" << oldest->offset << ") на диск");
-                LARGE_INTEGER old_pos;
-                old_pos.QuadPart = oldest->offset;
-                SetFilePointerEx(it->second, old_pos, NULL, FILE_BEGIN);
-                DWORD written;
-                WriteFile(it->second, oldest->data.data(), BLOCK_SIZE, &written, NULL);
-            }
-            blocks_map.erase(std::make_pair(oldest->fd, oldest->offset));
-            fifo_queue.pop();
-            delete oldest;
+// Упреждающая загрузка блоков [first_offset, first_offset + blocks * block_size) без ожидания:
+// блоки, которые уже в кэше, заняты вводом-выводом или не допущены фильтром, пропускаются,
+// под остальные резервируются блоки BLOCK_LOADING, и каждая непрерывная серия отправляется
+// движку асинхронного ввода-вывода. Вызывающий поток чтения не ждёт; обращение к блоку,
+// который ещё читается, ждёт только этот блок (см. get_block)
+static void prefetch_range(int fd, io_handle_t handle, off_t first_offset, size_t blocks) {
+    std::vector<LoadingBlock> loading;
+    {
+        std::unique_lock<std::mutex> lock;
+        CacheShard* locked = nullptr;
+        for (size_t i = 0; i < blocks; ++i) {
+            auto key = std::make_pair(fd, static_cast<off_t>(first_offset + i * block_size));
+            CacheShard& shard = shard_of(key);
+            switch_shard(lock, locked, shard);
+            if (shard.blocks_map.contains(key)) {
+                continue;
+            }
+            CacheBlock* block = allocate_block(shard, lock, key, true, false, "lab2_read");
+            if (block == nullptr) {
+                continue;
+            }
+            if (shard.blocks_map.contains(key)) {
+                release_block(shard, block);
+                continue;
+            }
+            if (restore_victim(shard, block)) {
+                index_block(shard, block);
+                block->prefetched = true;
+                stats_add(STAT_PREFETCH_ISSUED);
+                shard.eviction_policy->on_insert(block);
+                continue;
+            }
+            block->state = BLOCK_LOADING;
+            index_block(shard, block);
+            loading.push_back({key.second, block, 0});
         }
+    }
+    DEBUG_LOG("lab2_read: Упреждающее чтение " << loading.size() << " блоков (fd=" << fd << ", offset=" << first_offset << ")");
 
-        // Добавление нового блока
-        blocks_map[key] = new_block;
-        fifo_queue.push(new_block);
-        block_it = blocks_map.find(key); // обновили указатель на блок после того, как блок не был найден в кэше
-        DEBUG_LOG("lab2_read: Блок (fd=" << fd << ", offset=" << aligned_offset << ") добавлен в кэш");
-    } else {
-        std::lock_guard<std::mutex> lock(count_mutex);
-        cache_hit++;
+    for (size_t run_start = 0; run_start < loading.size();) {
+        size_t run_end = run_end_of(loading, run_start);
+        auto run = std::make_shared<std::vector<LoadingBlock>>(loading.begin() + run_start, loading.begin() + run_end);
+        std::vector<IoVec> iov = run_iov(*run, nullptr, 0, run->size());
+        io_engine().submit_read(handle, iov.data(), static_cast<int>(iov.size()), run->front().offset,
+            [run](ssize_t bytes) {
+                std::vector<ssize_t> loaded(run->size());
+                finish_run(*run, nullptr, 0, run->size(), bytes, loaded.data());
+                publish_prefetched(*run, loaded);
+            });
+        run_start = run_end;
+    }
+}
+
+// Упреждающее чтение после чтения [pos, pos + count) по шаблону доступа к файлу.
+// Окно обрезается по концу файла: блоки за ним не загружаются и не вытесняют чужие
+static void readahead(int fd, OpenFile& file, off_t pos, size_t count) {
+    std::vector<ReadaheadRange> ranges;
+    {
+        std::lock_guard<std::mutex> lock(file.readahead_mutex);
+        file.readahead.on_read(offset_to_block(pos), offset_to_block(pos + count - 1), ranges);
+    }
+    off_t size = file.size;
+    if (size <= 0) {
+        return;
+    }
+    int64_t last_block = static_cast<int64_t>(offset_to_block(size - 1));
+    for (const ReadaheadRange& range : ranges) {
+        if (range.first_block > last_block) {
+            continue;
+        }
+        size_t blocks = std::min<int64_t>(range.blocks, last_block - range.first_block + 1);
+        prefetch_range(fd, file.handle, static_cast<off_t>(range.first_block) << block_shift, blocks);
     }
+}
+
+// Загрузка серии тёплого старта упреждающим чтением. Блоки за концом файла пропускаются:
+// файл мог укоротиться после сохранения снимка. Возвращает false, если файл серии не открыт
+static bool warm_batch(const WarmBatch& batch) {
+    std::lock_guard<std::mutex> close_lock(warm_start.close_mutex);
+    int fd = -1;
+    std::shared_ptr<OpenFile> file;
+    {
+        std::shared_lock<std::shared_mutex> lock(files_mutex);
+        for (auto& [open_fd, open_file] : open_files) {
+            if (open_file->has_id && open_file->device == batch.device && open_file->inode == batch.inode) {
+                fd = open_fd;
+                file = open_file;
+                break;
+            }
+        }
+    }
+    if (file == nullptr) {
+        return false;
+    }
+    uint64_t file_blocks = (static_cast<uint64_t>(file->size.load()) + block_size - 1) >> block_shift;
+    if (batch.first_block < file_blocks) {
+        size_t blocks = std::min<uint64_t>(batch.blocks, file_blocks - batch.first_block);
+        prefetch_range(fd, file->handle, static_cast<off_t>(batch.first_block << block_shift), blocks);
+    }
+    return true;
+}
 
-    // Копирование данных в буфер
-    // (current_pos - aligned_offset) -- смещение данных внутри блока
-    size_t bytes_to_read = std::min(count, static_cast<size_t>(BLOCK_SIZE - (current_pos - aligned_offset)));
-    memcpy(buf, block_it->second->data.data() + (current_pos - aligned_offset), bytes_to_read);
-    DEBUG_LOG("lab2_read: Прочитано " << bytes_to_read << " байт из блока (fd=" << fd << ", offset=" << aligned_offset << ")");
+// Поток тёплого старта: по сигналу проходит по ждущим сериям; серии неоткрытых файлов
+// остаются ждать следующего lab2_open
+static void warm_loop() {
+    std::unique_lock<std::mutex> lock(warm_start.mutex);
+    for (;;) {
+        warm_start.wakeup.wait(lock, [] { return warm_start.stopping || warm_start.kicked; });
+        if (warm_start.stopping) {
+            return;
+        }
+        warm_start.kicked = false;
+        std::vector<WarmBatch> batches;
+        batches.swap(warm_start.pending);
+        lock.unlock();
+
+        std::vector<WarmBatch> waiting;
+        for (const WarmBatch& batch : batches) {
+            if (warm_start.stopping || !warm_batch(batch)) {
+                waiting.push_back(batch);
+            }
+        }
 
-    // Превентивная загрузка следующего блока
-    off_t next_offset = aligned_offset + BLOCK_SIZE;
-    auto next_key = std::make_pair(fd, next_offset);
-    if (blocks_map.find(next_key) == blocks_map.end()) {
-        DEBUG_LOG("lab2_read: Превентивная загрузка блока (fd=" << fd << ", offset=" << next_offset << ")");
-        CacheBlock* next_block = new CacheBlock{fd, next_offset, std::vector<char>(BLOCK_SIZE), false};
-        LARGE_INTEGER next_pos;
-        next_pos.QuadPart = next_offset;
-        SetFilePointerEx(it->second, next_pos, NULL, FILE_BEGIN);
-        DWORD next_bytes_read;
-        ReadFile(it->second, next_block->data.data(), BLOCK_SIZE, &next_bytes_read, NULL);
+        lock.lock();
+        // серии, добавленные за проход (повторный lab2_load_state), идут после ждущих
+        waiting.insert(waiting.end(), warm_start.pending.begin(), warm_start.pending.end());
+        warm_start.pending.swap(waiting);
+        warm_start.has_pending = !warm_start.pending.empty();
+    }
+}
+
+// Запись диапазона [pos, pos + count) в кэш, мьютекс шарда — раз на экстент
+static ssize_t write_range(int fd, const OpenFile& file, const char* buf, size_t count, off_t pos) {
+    off_t end = pos + count;
+    size_t unit = file.sector_size;
+    std::unique_lock<std::mutex> lock;
+    CacheShard* locked = nullptr;
+    for (off_t offset = block_start(pos); offset < end; offset += block_size) {
+        auto key = std::make_pair(fd, offset);
+        CacheShard& shard = shard_of(key);
+        switch_shard(lock, locked, shard);
+        shard.admission_filter.record(key);
+        CacheBlock* block = get_block(shard, lock, key, file.handle, false, false, "lab2_write");
+        if (block == nullptr) {
+            return offset > pos ? offset - pos : -1;
+        }
 
-        if (blocks_map.size() >= CACHE_CAPACITY) {
-            CacheBlock* oldest = fifo_queue.front();
-            DEBUG_LOG("lab2_read: Вытеснение блока (fd=" << oldest->fd << ", offset=" << oldest->offset << ") из кэша");
-            if (oldest->dirty) {
-                DEBUG_LOG("lab2_read: Сброс грязного блока (fd=" << oldest->fd << ", offset=" << oldest->offset << ") на диск");
-                LARGE_INTEGER old_pos;
-                old_pos.QuadPart = oldest->offset;
-                SetFilePointerEx(it->second, old_pos, NULL, FILE_BEGIN);
-                DWORD written;
-                WriteFile(it->second, oldest->data.data(), BLOCK_SIZE, &written, NULL);
+        // Границы записи внутри блока. Секторы (с выравниванием прямого ввода-вывода файла),
+        // которые запись задевает частично, должны содержать данные с диска
+        size_t from = std::max(pos, offset) - offset;
+        size_t to = std::min<off_t>(end, offset + block_size) - offset;
+        size_t unit_from = from / unit * unit;
+        size_t unit_to = std::min<size_t>((to + unit - 1) / unit * unit, block_size);
+        SectorMask partial = 0;
+        if (from != unit_from) {
+            partial |= sector_span(unit_from, unit_from + unit);
+        }
+        if (to != unit_to) {
+            partial |= sector_span(unit_to - unit, unit_to);
+        }
+        if ((partial & ~block->valid_sectors) != 0) {
+            DEBUG_LOG("lab2_write: Чтение блока (fd=" << fd << ", offset=" << offset << ") перед частичной записью");
+            if (!fill_block(shard, lock, block, file.handle)) {
+                return offset > pos ? offset - pos : -1;
             }
-            blocks_map.erase(std::make_pair(oldest->fd, oldest->offset));
-            fifo_queue.pop();
-            delete oldest;
         }
 
-        blocks_map[next_key] = next_block;
-        fifo_queue.push(next_block);
-        DEBUG_LOG("lab2_read: Блок (fd=" << fd << ", offset=" << next_offset << ") добавлен в кэш");
+        // Запись данных в кэш. Изменения из отображений файла переносятся в кадр до записи,
+        // а после неё страницы блока удаляются из отображений и загрузятся уже с новыми данными
+        SectorMask mapped = mmap_detach_block(fd, offset, block->data, false);
+        memcpy(block->data + from, buf + (offset + from - pos), to - from);
+        mapped |= mmap_detach_block(fd, offset, block->data, true);
+        SectorMask touched = sector_span(unit_from, unit_to) | mapped;
+        block->valid_sectors |= touched;
+        mark_dirty(shard, block, touched);
+        DEBUG_LOG("lab2_write: Записано " << (to - from) << " байт в блок (fd=" << fd << ", offset=" << offset << ")");
+    }
+    return count;
+}
+
+// Чтение с позиции pos без изменения позиции файла (общая часть lab2_read и lab2_pread)
+static ssize_t read_at(int fd, OpenFile& file, void* buf, size_t count, off_t pos) {
+    ssize_t bytes_read = read_range(fd, file.handle, static_cast<char*>(buf), count, pos);
+    if (bytes_read > 0) {
+        stats_add(STAT_BYTES_READ, bytes_read);
+        // Упреждающее чтение, если доступ к файлу последовательный или с постоянным шагом
+        readahead(fd, file, pos, bytes_read);
+    }
+    return bytes_read;
+}
+
+// Запись с позиции pos без изменения позиции файла (общая часть lab2_write и lab2_pwrite)
+static ssize_t write_at(int fd, OpenFile& file, const void* buf, size_t count, off_t pos) {
+    ssize_t written_bytes = write_range(fd, file, static_cast<const char*>(buf), count, pos);
+    if (written_bytes > 0) {
+        stats_add(STAT_BYTES_WRITTEN, written_bytes);
+        off_t end = pos + written_bytes;
+        off_t size = file.size;
+        while (size < end && !file.size.compare_exchange_weak(size, end)) {
+        }
+    }
+    return written_bytes;
+}
+
+// Фоновая запись и придержание писателя, обогнавшего её
+static void balance_dirty() {
+    kick_writeback();
+    throttle_writer();
+}
+
+// Чтение данных
+ssize_t lab2_read(int fd, void *buf, size_t count) {
+    DEBUG_LOG("lab2_read: Чтение из файла с fd=" << fd << ", count=" << count);
+    std::shared_ptr<OpenFile> file = find_file(fd);
+    if (!file) {
+        DEBUG_LOG("lab2_read: Файл с fd=" << fd << " не найден");
+        return -1;
     }
 
-    return bytes_to_read;
+    // Чтение сдвигает позицию файла, как и read()
+    uint64_t start = stats_now_ns();
+    std::lock_guard<std::mutex> lock(file->position_mutex);
+    trace_record(TRACE_READ, fd, file->position, count);
+    ssize_t bytes_read = read_at(fd, *file, buf, count, file->position);
+    if (bytes_read > 0) {
+        file->position += bytes_read;
+    }
+    stats_latency(LATENCY_READ, start);
+    return bytes_read;
 }
 
 // Запись данных
 ssize_t lab2_write(int fd, const void *buf, size_t count) {
     DEBUG_LOG("lab2_write: Запись в файл с fd=" << fd << ", count=" << count);
-    std::lock_guard<std::mutex> lock(cache_mutex);
-    auto it = open_files.find(fd);
-    if (it == open_files.end()) {
+    std::shared_ptr<OpenFile> file = find_file(fd);
+    if (!file) {
         DEBUG_LOG("lab2_write: Файл с fd=" << fd << " не найден");
         return -1;
     }
 
-    // Получаем текущую позицию в файле
-    off_t current_pos = lab2_lseek(fd, 0, SEEK_CUR);
-    if (current_pos == -1) {
-        DEBUG_LOG("lab2_write: Ошибка получения текущей позиции файла");
-        return -1;
+    uint64_t start = stats_now_ns();
+    ssize_t written_bytes;
+    {
+        std::lock_guard<std::mutex> lock(file->position_mutex);
+        trace_record(TRACE_WRITE, fd, file->position, count);
+        written_bytes = write_at(fd, *file, buf, count, file->position);
+        if (written_bytes > 0) {
+            file->position += written_bytes;
+        }
     }
+    balance_dirty();
+    stats_latency(LATENCY_WRITE, start);
+    return written_bytes;
+}
 
-    off_t aligned_offset = current_pos & ~(BLOCK_SIZE - 1);
+// Чтение данных с заданного смещения
+ssize_t lab2_pread(int fd, void *buf, size_t count, off_t offset) {
+    DEBUG_LOG("lab2_pread: Чтение из файла с fd=" << fd << ", count=" << count << ", offset=" << offset);
+    std::shared_ptr<OpenFile> file = find_file(fd);
+    if (!file || offset < 0) {
+        DEBUG_LOG("lab2_pread: Файл с fd=" << fd << " не найден или смещение отрицательно");
+        return -1;
+    }
+    trace_record(TRACE_READ, fd, offset, count);
+    uint64_t start = stats_now_ns();
+    ssize_t bytes_read = read_at(fd, *file, buf, count, offset);
+    stats_latency(LATENCY_READ, start);
+    return bytes_read;
+}
 
-    // Поиск блока в кэше
-    auto key = std::make_pair(fd, aligned_offset);
-    auto block_it = blocks_map.find(key);
-    if (block_it == blocks_map.end()) {
-        std::lock_guard<std::mutex> lock(count_mutex);
-        cache_miss++;
-        DEBUG_LOG("lab2_write: Блок (fd=" << fd << ", offset=" << aligned_offset << ") не найден в кэше, создание нового");
-        CacheBlock* new_block = new CacheBlock{fd, aligned_offset, std::vector<char>(BLOCK_SIZE), false};
+// Запись данных с заданного смещения
+ssize_t lab2_pwrite(int fd, const void *buf, size_t count, off_t offset) {
+    DEBUG_LOG("lab2_pwrite: Запись в файл с fd=" << fd << ", count=" << count << ", offset=" << offset);
+    std::shared_ptr<OpenFile> file = find_file(fd);
+    if (!file || offset < 0) {
+        DEBUG_LOG("lab2_pwrite: Файл с fd=" << fd << " не найден или смещение отрицательно");
+        return -1;
+    }
+    trace_record(TRACE_WRITE, fd, offset, count);
+    uint64_t start = stats_now_ns();
+    ssize_t written_bytes = write_at(fd, *file, buf, count, offset);
+    balance_dirty();
+    stats_latency(LATENCY_WRITE, start);
+    return written_bytes;
+}
 
-        // Вытеснение старого блока, если кэш заполнен
-        if (blocks_map.size() >= CACHE_CAPACITY) {
-            CacheBlock* oldest = fifo_queue.front();
-            DEBUG_LOG("lab2_write: Вытеснение блока (fd=" << oldest->fd << ", offset=" << oldest->offset << ") из кэша");
-            if (oldest->dirty) {
-                DEBUG_LOG("lab2_write: Сброс грязного блока (fd=" << oldest->fd << ", offset=" << oldest->offset << ") на диск");
-                LARGE_INTEGER old_pos;
-                old_pos.QuadPart = oldest->offset;
-                SetFilePointerEx(it->second, old_pos, NULL, FILE_BEGIN);
-                DWORD written;
-                WriteFile(it->second, oldest->data.data(), BLOCK_SIZE, &written, NULL);
-            }
-            blocks_map.erase(std::make_pair(oldest->fd, oldest->offset));
-            fifo_queue.pop();
-            delete oldest;
+// Выдача страницы кэша с байтом offset без копирования (общая часть lab2_get_page,
+// lab2_get_page_writable и cache_pin_mapped). Блок загружается целиком и закрепляется до
+// lab2_put_page. internal — обращение самого кэша: оно не пишется в трассу и не учитывается
+// в счётчиках попаданий/промахов
+static int get_page(int fd, off_t offset, bool writable, char** page, const char* caller, bool internal = false) {
+    std::shared_ptr<OpenFile> file = find_file(fd);
+    if (!file || offset < 0 || page == nullptr) {
+        DEBUG_LOG(caller << ": Файл с fd=" << fd << " не найден или неверные параметры");
+        return -1;
+    }
+    auto key = std::make_pair(fd, block_start(offset));
+    if (!internal) {
+        trace_record(writable ? TRACE_WRITE : TRACE_READ, fd, offset, block_size - (offset - key.second));
+    }
+    CacheShard& shard = shard_of(key);
+    std::unique_lock<std::mutex> lock(shard.mutex);
+    shard.admission_filter.record(key);
+    // страница должна остаться в кэше, поэтому фильтр допуска не применяется
+    CacheBlock* block = get_block(shard, lock, key, file->handle, true, false, caller, internal);
+    if (block == nullptr) {
+        return -1;
+    }
+    if (block->valid_sectors != all_sectors && !fill_block(shard, lock, block, file->handle)) {
+        return -1;
+    }
+    block->page_refs++;
+    if (writable) {
+        // изменения из отображений файла попадают в кадр раньше изменений через страницу
+        mmap_detach_block(fd, key.second, block->data, false);
+        block->page_writers++;
+        mark_dirty(shard, block, all_sectors);
+        off_t end = key.second + block_size;
+        off_t size = file->size;
+        while (size < end && !file->size.compare_exchange_weak(size, end)) {
         }
-
-        // Добавление нового блока
-        blocks_map[key] = new_block;
-        fifo_queue.push(new_block);
-        block_it = blocks_map.find(key);
-        DEBUG_LOG("lab2_write: Блок (fd=" << fd << ", offset=" << aligned_offset << ") добавлен в кэш");
-    } else {
-        std::lock_guard<std::mutex> lock(count_mutex);
-        cache_hit++;
     }
+    size_t in_block = offset - key.second;
+    *page = block->data + in_block;
+    return static_cast<int>(block_size - in_block);
+}
 
-    // Запись данных в кэш
-    size_t bytes_to_write = std::min(count, static_cast<size_t>(BLOCK_SIZE - (current_pos - aligned_offset)));
-    memcpy(block_it->second->data.data() + (current_pos - aligned_offset), buf, bytes_to_write);
-
-    // fix
-    ssize_t written_bytes = bytes_to_write;
-    lab2_lseek(fd, written_bytes, SEEK_CUR);
+// Страница для чтения
+int lab2_get_page(int fd, off_t offset, const void **page) {
+    char* data = nullptr;
+    int available = get_page(fd, offset, false, &data, "lab2_get_page");
+    if (page != nullptr) {
+        *page = data;
+    }
+    return available;
+}
 
-    block_it->second->dirty = true;
-    DEBUG_LOG("lab2_write: Записано " << bytes_to_write << " байт в блок (fd=" << fd << ", offset=" << aligned_offset << ")");
+// Страница для записи
+int lab2_get_page_writable(int fd, off_t offset, void **page) {
+    char* data = nullptr;
+    int available = get_page(fd, offset, true, &data, "lab2_get_page_writable");
+    if (page != nullptr) {
+        *page = data;
+    }
+    balance_dirty();
+    return available;
+}
 
-    return bytes_to_write;
+// Возврат страницы. Пока страница выдана на запись, каждый возврат снова помечает блок
+// грязным: изменения, сделанные после фонового сброса, тоже попадут на диск
+int lab2_put_page(const void *page) {
+    CacheBlock* block = page != nullptr ? frame_arena.block_of(page) : nullptr;
+    if (block == nullptr) {
+        DEBUG_LOG("lab2_put_page: Адрес не принадлежит кэшу");
+        return -1;
+    }
+    // выданный блок не вытесняется, поэтому его ключ неизменен, пока страница не возвращена
+    int fd = block->fd;
+    off_t offset = block->offset;
+    CacheShard& shard = shard_of(std::make_pair(fd, offset));
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (block->page_refs == 0 || block->fd != fd || block->offset != offset) {
+        DEBUG_LOG("lab2_put_page: Страница (fd=" << fd << ", offset=" << offset << ") не выдавалась");
+        return -1;
+    }
+    if (block->page_writers > 0) {
+        // кадр менялся через страницу: отображения загрузят блок заново
+        mmap_detach_block(fd, offset, block->data, true);
+        mark_dirty(shard, block, all_sectors);
+    }
+    if (--block->page_refs == 0) {
+        block->page_writers = 0;
+    }
+    return 0;
 }
 
-// Перемещение указателя файла
+// Перемещение указателя файла. Позиция хранится в OpenFile, системных вызовов нет
 off_t lab2_lseek(int fd, off_t offset, int whence) {
     DEBUG_LOG("lab2_lseek: Перемещение указателя файла с fd=" << fd << ", offset=" << offset << ", whence=" << whence);
-    // std::lock_guard<std::mutex> lock(cache_mutex); // TODO: иначе это повторный захват мьютекса в функциях read и write
-    auto it = open_files.find(fd);
-    if (it == open_files.end()) {
+    std::shared_ptr<OpenFile> file = find_file(fd);
+    if (!file) {
         DEBUG_LOG("lab2_lseek: Файл с fd=" << fd << " не найден");
         return -1;
     }
 
-    LARGE_INTEGER new_pos;
-    new_pos.QuadPart = offset;
-    LARGE_INTEGER result_pos;
-    if (!SetFilePointerEx(it->second, new_pos, &result_pos, whence)) {
-        DEBUG_LOG("lab2_lseek: Ошибка перемещения указателя файла. Код ошибки: " << GetLastError());
+    std::lock_guard<std::mutex> lock(file->position_mutex);
+    off_t base;
+    switch (whence) {
+        case SEEK_SET:
+            base = 0;
+            break;
+        case SEEK_CUR:
+            base = file->position;
+            break;
+        case SEEK_END:
+            base = file->size;
+            break;
+        default:
+            DEBUG_LOG("lab2_lseek: Неизвестный whence=" << whence);
+            return -1;
+    }
+    if (base + offset < 0) {
+        DEBUG_LOG("lab2_lseek: Ошибка перемещения указателя файла");
         return -1;
     }
+    file->position = base + offset;
+
+    DEBUG_LOG("lab2_lseek: Указатель файла перемещен на позицию " << file->position);
+    return file->position;
+}
+
+// Отображение файла в память. Файл, который короче отображения, удлиняется на диске
+// (как ftruncate перед mmap), чтобы все страницы отображения лежали внутри файла
+void *lab2_mmap(int fd, off_t offset, size_t len) {
+    std::shared_ptr<OpenFile> file = find_file(fd);
+    if (!file || offset < 0 || len == 0) {
+        DEBUG_LOG("lab2_mmap: Файл с fd=" << fd << " не найден или неверные параметры");
+        return nullptr;
+    }
+    off_t end = offset + static_cast<off_t>(len);
+    off_t size = file->size;
+    if (size < end) {
+        if (io_seek(file->handle, 0, SEEK_END) < end && io_truncate(file->handle, end) != 0) {
+            DEBUG_LOG("lab2_mmap: Не удалось удлинить файл с fd=" << fd);
+            return nullptr;
+        }
+        while (size < end && !file->size.compare_exchange_weak(size, end)) {
+        }
+    }
+    void* addr = mmap_create(fd, offset, len);
+    DEBUG_LOG("lab2_mmap: Отображение fd=" << fd << ", offset=" << offset << ", len=" << len << " -> " << addr);
+    return addr;
+}
+
+// Кадр блока для загрузки страниц отображения. Обращение к отображению — не вызов lab2_*,
+// поэтому оно не попадает ни в трассу, ни в счётчики
+const char* cache_pin_mapped(int fd, off_t block_offset) {
+    char* data = nullptr;
+    return get_page(fd, block_offset, false, &data, "mmap", true) < 0 ? nullptr : data;
+}
+
+// Перенос грязных страниц отображений блока в кэш. Страницы отображений есть только
+// у блоков в кэше: вытесняемый блок забирает их сам (evict_block)
+void cache_sync_mapped(int fd, off_t block_offset) {
+    auto key = std::make_pair(fd, block_offset);
+    CacheShard& shard = shard_of(key);
+    std::unique_lock<std::mutex> lock(shard.mutex);
+    for (;;) {
+        CacheBlock* block = shard.blocks_map.find(key);
+        if (block == nullptr) {
+            return;
+        }
+        if (block->state != BLOCK_READY) {
+            shard.io_done.wait(lock);
+            continue;
+        }
+        if (SectorMask mapped = mmap_detach_block(fd, block_offset, block->data, false)) {
+            mark_dirty(shard, block, mapped);
+        }
+        return;
+    }
+}
+
+int lab2_msync(void *addr, size_t len) {
+    return mmap_sync(addr, len);
+}
 
-    DEBUG_LOG("lab2_lseek: Указатель файла перемещен на позицию " << result_pos.QuadPart);
-    return static_cast<off_t>(result_pos.QuadPart);
+int lab2_munmap(void *addr, size_t len) {
+    return mmap_destroy(addr, len);
+}
+
+// Размер файла с учётом несброшенных записей
+off_t lab2_file_size(int fd) {
+    std::shared_ptr<OpenFile> file = find_file(fd);
+    if (!file) {
+        DEBUG_LOG("lab2_file_size: Файл с fd=" << fd << " не найден");
+        return -1;
+    }
+    return file->size;
 }
 
 // Синхронизация данных с диском
 int lab2_fsync(int fd) {
     DEBUG_LOG("lab2_fsync: Синхронизация файла с fd=" << fd);
-    std::lock_guard<std::mutex> lock(cache_mutex);
-    auto it = open_files.find(fd);
-    if (it == open_files.end()) {
+    io_handle_t handle;
+    if (!find_handle(fd, &handle)) {
         DEBUG_LOG("lab2_fsync: Файл с fd=" << fd << " не найден");
         return -1;
     }
 
     // Сброс всех "грязных" блоков на диск
-    for (auto& pair : blocks_map) {
-        if (pair.first.first == fd && pair.second->dirty) {
-            DEBUG_LOG("lab2_fsync: Сброс грязного блока (fd=" << fd << ", offset=" << pair.second->offset << ") на диск");
-            LARGE_INTEGER pos;
-            pos.QuadPart = pair.second->offset;
-            SetFilePointerEx(it->second, pos, NULL, FILE_BEGIN);
-            DWORD written;
-            WriteFile(it->second, pair.second->data.data(), BLOCK_SIZE, &written, NULL);
-            pair.second->dirty = false;
-        }
+    trace_record(TRACE_FSYNC, fd);
+    uint64_t start = stats_now_ns();
+    // записи через отображения сначала переносятся в кэш
+    int result = mmap_sync_file(fd);
+    if (flush_file(fd, "lab2_fsync") != 0) {
+        result = -1;
     }
+    stats_latency(LATENCY_FSYNC, start);
 
     DEBUG_LOG("lab2_fsync: Синхронизация завершена для файла с fd=" << fd);
+    return result;
+}
+
+// Запись трассы обращений
+int lab2_trace_start(const char *path) {
+    if (path == nullptr || !trace_start(path)) {
+        DEBUG_LOG("lab2_trace_start: Не удалось создать файл трассы");
+        return -1;
+    }
+    return 0;
+}
+
+int lab2_trace_stop() {
+    trace_stop();
+    return 0;
+}
+
+// Снимок кэша: блоки открытых файлов с рангом по их месту в порядке политики своего шарда
+int lab2_save_state(const char *path) {
+    if (path == nullptr) {
+        return -1;
+    }
+    std::unordered_map<int, std::shared_ptr<OpenFile>> files;
+    {
+        std::shared_lock<std::shared_mutex> lock(files_mutex);
+        files = open_files;
+    }
+
+    // блоки по идентичности файла: один файл может быть открыт несколько раз
+    std::map<std::pair<uint64_t, uint64_t>, SnapshotFileKeys> keys;
+    std::vector<CacheBlock*> order;
+    for (CacheShard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        order.clear();
+        shard.eviction_policy->ranked(order);
+        for (size_t i = 0; i < order.size(); ++i) {
+            CacheBlock* block = order[i];
+            auto it = files.find(block->fd);
+            if (block->state != BLOCK_READY || it == files.end() || !it->second->has_id) {
+                continue;
+            }
+            const OpenFile& file = *it->second;
+            SnapshotFileKeys& file_keys = keys[{file.device, file.inode}];
+            file_keys.device = file.device;
+            file_keys.inode = file.inode;
+            file_keys.size = static_cast<uint64_t>(file.size.load());
+            auto rank = static_cast<uint32_t>(order.size() > 1 ? i * SNAPSHOT_RANK_MAX / (order.size() - 1) : 0);
+            file_keys.blocks.push_back({offset_to_block(block->offset), rank});
+        }
+    }
+
+    std::vector<SnapshotFileKeys> snapshot;
+    for (auto& [id, file_keys] : keys) {
+        auto& blocks = file_keys.blocks;
+        std::sort(blocks.begin(), blocks.end(), [](const SnapshotBlock& a, const SnapshotBlock& b) {
+            return a.block != b.block ? a.block < b.block : a.rank < b.rank;
+        });
+        blocks.erase(std::unique(blocks.begin(), blocks.end(),
+                                 [](const SnapshotBlock& a, const SnapshotBlock& b) { return a.block == b.block; }),
+                     blocks.end());
+        snapshot.push_back(std::move(file_keys));
+    }
+    if (!snapshot_save(path, block_shift, snapshot)) {
+        DEBUG_LOG("lab2_save_state: Ошибка записи снимка " << path);
+        return -1;
+    }
+    DEBUG_LOG("lab2_save_state: Сохранены блоки " << snapshot.size() << " файлов в " << path);
+    return 0;
+}
+
+// Тёплый старт: самые горячие блоки снимка (не больше ёмкости кэша) разбиваются на
+// WARM_TIERS ступеней ранга, внутри ступени сортируются по файлам и смещениям и режутся
+// на серии подряд идущих блоков не длиннее WARM_BATCH_BLOCKS
+int lab2_load_state(const char *path) {
+    if (path == nullptr || !ensure_cache()) {
+        return -1;
+    }
+    uint32_t saved_shift;
+    std::vector<SnapshotFileKeys> snapshot;
+    std::string error;
+    if (!snapshot_load(path, saved_shift, snapshot, error)) {
+        DEBUG_LOG("lab2_load_state: " << path << ": " << error);
+        return -1;
+    }
+
+    struct WarmKey {
+        uint32_t rank;
+        uint64_t device;
+        uint64_t inode;
+        uint64_t block;
+    };
+    std::vector<WarmKey> warm_keys;
+    for (const SnapshotFileKeys& file_keys : snapshot) {
+        for (const SnapshotBlock& saved : file_keys.blocks) {
+            if (saved.block > (static_cast<uint64_t>(INT64_MAX) >> saved_shift)) {
+                continue;
+            }
+            // снимок мог быть сделан с другим размером блока: номер пересчитывается через смещение
+            uint64_t block = offset_to_block(static_cast<off_t>(saved.block << saved_shift));
+            warm_keys.push_back({saved.rank, file_keys.device, file_keys.inode, block});
+        }
+    }
+    size_t capacity = cache_capacity;
+    if (warm_keys.size() > capacity) {
+        std::nth_element(warm_keys.begin(), warm_keys.begin() + capacity, warm_keys.end(),
+                         [](const WarmKey& a, const WarmKey& b) { return a.rank < b.rank; });
+        warm_keys.resize(capacity);
+    }
+    auto tier = [](const WarmKey& key) { return key.rank * WARM_TIERS / (SNAPSHOT_RANK_MAX + 1); };
+    std::sort(warm_keys.begin(), warm_keys.end(), [&](const WarmKey& a, const WarmKey& b) {
+        return std::make_tuple(tier(a), a.device, a.inode, a.block) < std::make_tuple(tier(b), b.device, b.inode, b.block);
+    });
+
+    std::vector<WarmBatch> batches;
+    for (size_t i = 0; i < warm_keys.size(); ++i) {
+        const WarmKey& key = warm_keys[i];
+        if (!batches.empty() && tier(warm_keys[i - 1]) == tier(key)) {
+            WarmBatch& last = batches.back();
+            if (last.device == key.device && last.inode == key.inode && key.block < last.first_block + last.blocks) {
+                continue;  // тот же блок (снимок с меньшим размером блока)
+            }
+            if (last.device == key.device && last.inode == key.inode &&
+                key.block == last.first_block + last.blocks && last.blocks < WARM_BATCH_BLOCKS) {
+                last.blocks++;
+                continue;
+            }
+        }
+        batches.push_back({key.device, key.inode, key.block, 1});
+    }
+    DEBUG_LOG("lab2_load_state: " << warm_keys.size() << " блоков в " << batches.size() << " сериях");
+
+    std::call_once(warm_start.started, [] {
+        // движок ввода-вывода создаётся раньше, чтобы поток остановился до его разрушения
+        io_engine();
+        warm_start.thread = std::thread(warm_loop);
+        std::atexit([] { warm_start.stop(); });
+    });
+    {
+        std::lock_guard<std::mutex> lock(warm_start.mutex);
+        warm_start.pending.insert(warm_start.pending.end(), batches.begin(), batches.end());
+        warm_start.has_pending = !warm_start.pending.empty();
+        warm_start.kicked = true;
+    }
+    warm_start.wakeup.notify_one();
+    return 0;
+}
+
+// Статистика
+int lab2_get_stats(struct lab2_stats *stats) {
+    if (stats == nullptr) {
+        return -1;
+    }
+    stats_collect(stats, false);
+    stats->capacity_bytes = cache_capacity * block_size;
+    stats->huge_page_bytes = frame_arena.huge_bytes();
+    stats->victim_blocks = 0;
+    stats->victim_bytes = 0;
+    for (CacheShard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        stats->victim_blocks += shard.victim_tier.blocks();
+        stats->victim_bytes += shard.victim_tier.used_bytes();
+    }
     return 0;
 }
 
+void lab2_reset_stats() {
+    lab2_stats stats;
+    stats_collect(&stats, true);
+    lab2_group_stats group_stats;
+    for (uint8_t group = 0; group < LAB2_MAX_GROUPS; ++group) {
+        stats_collect_group(group, &group_stats, true);
+    }
+}
+
+// Печать задержек одного вида операций, если они были
+static void print_latency(const char* name, const lab2_latency& latency) {
+    if (latency.count == 0) {
+        return;
+    }
+    std::cout << name << ": " << latency.count << " ops, avg " << latency.total_ns / latency.count / 1000
+              << " us, p50 < " << latency_percentile(latency, 0.5) / 1000 << " us, p99 < "
+              << latency_percentile(latency, 0.99) / 1000 << " us" << std::endl;
+}
+
 void print_hm() {
-    std::cout << "Cache hit: " << cache_hit << ", Cache miss: " << cache_miss << std::endl;
-    cache_hit = cache_miss = 0;
-}
\ No newline at end of file
+    lab2_stats stats;
+    stats_collect(&stats, true);
+    std::cout << "Cache hit: " << stats.hits << ", Cache miss: " << stats.misses << std::endl;
+    if (stats.evictions > 0) {
+        std::cout << "Evicted: " << stats.evictions << ", dirty: " << stats.dirty_evictions << std::endl;
+    }
+    if (stats.prefetch_issued > 0) {
+        std::cout << "Prefetched: " << stats.prefetch_issued << ", used: " << stats.prefetch_used
+                  << ", evicted unused: " << stats.prefetch_wasted << std::endl;
+    }
+    if (stats.writeback_batches > 0) {
+        std::cout << "Writeback: " << stats.writeback_blocks << " blocks in " << stats.writeback_batches << " batches"
+                  << std::endl;
+    }
+    if (stats.disk_writes > 0) {
+        uint64_t average = stats.disk_write_bytes * 10 / stats.disk_writes / 1024;  // в десятых долях КБ
+        std::cout << "Disk writes: " << stats.disk_writes << ", average size: " << average / 10 << "." << average % 10
+                  << " KB" << std::endl;
+    }
+    print_latency("Read latency", stats.read_latency);
+    print_latency("Write latency", stats.write_latency);
+    print_latency("Fsync latency", stats.fsync_latency);
+    if (size_t huge = frame_arena.huge_bytes()) {
+        std::cout << "Huge pages: " << huge / (1024 * 1024) << " MB of frames" << std::endl;
+    }
+    if (stats.victim_stores > 0 || stats.victim_hits > 0) {
+        lab2_stats current;
+        lab2_get_stats(&current);
+        std::cout << "Victim tier: " << stats.victim_hits << " hits, " << stats.victim_stores << " stored, "
+                  << current.victim_blocks << " blocks in " << current.victim_bytes / 1024 << " KB" << std::endl;
+    }
+    for (int group = 0; groups_in_use && group < LAB2_MAX_GROUPS; ++group) {
+        lab2_group_stats group_stats;
+        lab2_get_group_stats(group, &group_stats);
+        stats_collect_group(static_cast<uint8_t>(group), &group_stats, true);
+        if (group_stats.resident_bytes == 0 && group_stats.hits + group_stats.misses == 0) {
+            continue;
+        }
+        std::cout << "Group " << group << ": " << group_stats.resident_bytes / 1024 << " KB resident, hit: "
+                  << group_stats.hits << ", miss: " << group_stats.misses << ", evicted: " << group_stats.evictions
+                  << std::endl;
+    }
+}
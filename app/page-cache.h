@@ -6,6 +6,7 @@
 #define PAGE_CACHE_H
 
 #include <stddef.h>  // Для size_t
+#include <stdint.h>  // Для uint64_t
 #include <sys/types.h>  // Для off_t и ssize_t
 
 #ifdef _WIN32
@@ -18,13 +19,46 @@
 extern "C" {
 #endif
 
+    // Параметры кэша
+    struct lab2_config {
+        size_t memory_bytes;  // Память под данные блоков; 0 — 100 МБ
+        size_t block_size;    // Размер блока: степень двойки от 4 до 64 КБ; 0 — 4 КБ
+        int huge_pages;       // 1 — данные блоков на больших страницах (2 МБ), если ОС их даёт:
+                              // меньше промахов TLB при случайном доступе к большому кэшу
+    };
+
+    // Настройка кэша до открытия первого файла. Без вызова lab2_init кэш настраивается
+    // по умолчанию при первом lab2_open. Повторный вызов допустим, пока не открыт ни один файл.
+    // config == NULL — настройки по умолчанию.
+    // Возвращает 0 в случае успеха, -1 при неверных параметрах, открытых файлах или нехватке памяти.
+    LAB2_API int lab2_init(const struct lab2_config *config);
+
+    // Изменение памяти кэша на ходу (размер блока сохраняется). При уменьшении лишние блоки
+    // вытесняются, грязные записываются на диск, память отдаётся ОС; блоки, выданные
+    // lab2_get_page, освобождаются после lab2_put_page.
+    // Возвращает 0 в случае успеха, -1 если памяти меньше 16 блоков или её не удалось выделить
+    // (тогда кэш остаётся того размера, который удалось получить).
+    LAB2_API int lab2_resize(size_t memory_bytes);
+
     // Открытие файла по заданному пути файла, доступного для чтения.
     // Процедура возвращает некоторый хэндл на файл.
     // Возвращает -1 в случае ошибки.
     LAB2_API int lab2_open(const char *path);
 
+    // Флаги lab2_open_flags
+    #define LAB2_OPEN_CREATE    0x1  // создать файл, если его нет
+    #define LAB2_OPEN_TRUNCATE  0x2  // обрезать существующий файл до нуля
+    #define LAB2_OPEN_EXCLUSIVE 0x4  // вместе с LAB2_OPEN_CREATE: ошибка, если файл уже есть
+
+    // Открытие файла для чтения и записи с флагами LAB2_OPEN_*; lab2_open(path) — то же, что
+    // lab2_open_flags(path, LAB2_OPEN_CREATE | LAB2_OPEN_TRUNCATE). Без флагов открывается
+    // существующий файл с его содержимым.
+    // Возвращает хэндл или -1 в случае ошибки (errno — от ОС).
+    LAB2_API int lab2_open_flags(const char *path, int flags);
+
     // Закрытие файла по хэндлу.
-    // Возвращает 0 в случае успеха, -1 в случае ошибки.
+    // Возвращает 0 в случае успеха, -1 в случае ошибки. Если грязные блоки не удалось
+    // записать на диск, файл остаётся открытым, и закрытие можно повторить.
     LAB2_API int lab2_close(int fd);
 
     // Чтение данных из файла.
@@ -41,18 +75,203 @@ extern "C" {
     // Возвращает количество записанных байт или -1 в случае ошибки.
     LAB2_API ssize_t lab2_write(int fd, const void *buf, size_t count);
 
+    // Чтение и запись с заданного смещения offset, не меняющие позицию указателя файла
+    // (аналог pread/pwrite). Несколько потоков могут работать с одним fd одновременно.
+    // Возвращают количество прочитанных/записанных байт или -1 в случае ошибки.
+    LAB2_API ssize_t lab2_pread(int fd, void *buf, size_t count, off_t offset);
+    LAB2_API ssize_t lab2_pwrite(int fd, const void *buf, size_t count, off_t offset);
+
+    // Доступ к странице кэша без копирования.
+    // В *page записывается адрес байта offset внутри кадра кэша; возвращается число байт,
+    // доступных от него до конца страницы, или -1 в случае ошибки. Страница закрепляется:
+    // она не вытесняется, пока не будет возвращена lab2_put_page. Закрыть файл с
+    // невозвращёнными страницами нельзя (lab2_close вернёт -1).
+    // lab2_get_page_writable выдаёт страницу для изменения: вся страница считается грязной
+    // и будет записана на диск после возврата (и, возможно, раньше); файл при этом
+    // дорастает до конца страницы.
+    LAB2_API int lab2_get_page(int fd, off_t offset, const void **page);
+    LAB2_API int lab2_get_page_writable(int fd, off_t offset, void **page);
+
+    // Возврат страницы, полученной lab2_get_page или lab2_get_page_writable.
+    // page — любой адрес внутри страницы. Возвращает 0 в случае успеха, -1 в случае ошибки.
+    LAB2_API int lab2_put_page(const void *page);
+
+    // Отображение [offset, offset + len) файла в память (Linux 5.7+, userfaultfd).
+    // Страницы загружаются из кэша при первом обращении и остаются в памяти, пока их блок
+    // в кэше. Запись в отображение попадает в кэш (и затем на диск) при lab2_msync, lab2_fsync,
+    // lab2_munmap и вытеснении блока; запись через lab2_write видна в отображении. Если блок
+    // не удалось прочитать, обращение к странице получает SIGBUS. Файл короче offset + len
+    // дорастает до этого размера. offset кратен размеру страницы ОС; закрыть файл с
+    // отображениями нельзя (lab2_close вернёт -1). Отображение не наследуется при fork.
+    // Возвращает адрес или NULL в случае ошибки (в том числе если userfaultfd недоступен).
+    LAB2_API void *lab2_mmap(int fd, off_t offset, size_t len);
+
+    // Перенос записанных страниц [addr, addr + len) отображения в кэш.
+    // Возвращает 0 в случае успеха, -1 в случае ошибки.
+    LAB2_API int lab2_msync(void *addr, size_t len);
+
+    // Перенос записанных страниц в кэш и удаление отображения; addr и len — как у lab2_mmap.
+    // Возвращает 0 в случае успеха, -1 в случае ошибки.
+    LAB2_API int lab2_munmap(void *addr, size_t len);
+
     // Перестановка позиции указателя на данные файла.
+    // Позиция хранится в библиотеке, обращения к ОС не требуется.
     // fd — дескриптор файла.
     // offset — новое смещение.
     // whence — флаг (например, SEEK_SET для абсолютного смещения).
     // Возвращает новое смещение или -1 в случае ошибки.
     LAB2_API off_t lab2_lseek(int fd, off_t offset, int whence);
 
+    // Размер файла с учётом записей, ещё не сброшенных на диск.
+    // lab2_read и lab2_pread не останавливаются на конце файла (блок за концом читается
+    // нулями), поэтому вызывающий, которому нужен конец файла, ограничивает чтение этим размером.
+    // Возвращает размер или -1 в случае ошибки.
+    LAB2_API off_t lab2_file_size(int fd);
+
     // Синхронизация данных из кэша с диском.
     // fd — дескриптор файла.
     // Возвращает 0 в случае успеха, -1 в случае ошибки.
     LAB2_API int lab2_fsync(int fd);
 
+    // Политики вытеснения блоков из кэша
+    enum lab2_eviction_policy {
+        LAB2_POLICY_FIFO = 0,   // самый старый блок
+        LAB2_POLICY_LRU,        // давно не использованный блок
+        LAB2_POLICY_CLOCK,      // второй шанс по биту обращения
+        LAB2_POLICY_2Q,         // 2Q: FIFO для новых блоков + LRU для повторно запрошенных
+        LAB2_POLICY_S3FIFO,     // S3-FIFO: малая + основная FIFO и призрачная очередь
+    };
+
+    // Выбор политики вытеснения (по умолчанию LAB2_POLICY_S3FIFO).
+    // Допустим, только пока не открыт ни один файл (кэш пуст).
+    // Возвращает 0 в случае успеха, -1 в случае ошибки.
+    LAB2_API int lab2_set_eviction_policy(int policy);
+
+    // Включение (enabled != 0) или выключение фильтра допуска TinyLFU (по умолчанию выключен).
+    // При включённом фильтре промах чтения и превентивная загрузка вытесняют блок, только
+    // если новый блок запрашивался чаще жертвы; иначе данные читаются в обход кэша.
+    // Возвращает 0 в случае успеха.
+    LAB2_API int lab2_set_admission_filter(int enabled);
+
+    // Параметры фоновой записи грязных блоков (аналог dirty_background_ratio, dirty_ratio и
+    // dirty_expire_centisecs ядра Linux).
+    // background_ratio — доля грязных блоков в кэше (%), с которой фоновый поток начинает запись;
+    // dirty_ratio — доля (%), при которой lab2_write ждёт, пока фоновый поток не догонит;
+    // expire_ms — возраст грязного блока (мс), после которого он записывается в любом случае.
+    // По умолчанию 10 %, 20 % и 30000 мс. Возвращает 0 в случае успеха, -1 при неверных значениях.
+    LAB2_API int lab2_set_writeback(int background_ratio, int dirty_ratio, int expire_ms);
+
+    // Наибольший размер одной записи на диск (байт). Грязные блоки сбрасываются в порядке
+    // смещений, и соседние блоки файла объединяются в одну векторную запись не больше
+    // max_bytes (округляется вниз до целого блока, не больше 4 МБ). По умолчанию 1 МБ.
+    // Возвращает 0 в случае успеха, -1 если max_bytes меньше блока.
+    LAB2_API int lab2_set_max_write(size_t max_bytes);
+
+    // Ярус вытесненных блоков: чистые блоки, вытесненные из кэша, хранятся сжатыми
+    // (встроенный LZ-кодек; блоки из одного повторённого байта — одним байтом) в отдельной
+    // памяти memory_bytes, и промах по ним обходится распаковкой без чтения с диска.
+    // Блоки, которые не сжимаются хотя бы вдвое, не хранятся. 0 (по умолчанию) выключает ярус.
+    // Возвращает 0.
+    LAB2_API int lab2_set_victim_tier(size_t memory_bytes);
+
+    // Группы файлов для квот памяти. Каждый файл принадлежит одной группе (по умолчанию 0),
+    // блоки кэша учитываются за группой своего файла
+    #define LAB2_MAX_GROUPS 8
+
+    // Перевод файла в группу group (0 .. LAB2_MAX_GROUPS - 1); его блоки, уже лежащие в кэше,
+    // переходят в новую группу. Возвращает 0 в случае успеха, -1 в случае ошибки.
+    LAB2_API int lab2_set_file_group(int fd, int group);
+
+    // Резерв и предел памяти группы. Блоки группы, которая держит не больше min_bytes,
+    // не вытесняются ради других групп; группа, занявшая max_bytes (0 — без предела),
+    // вытесняет для новых блоков только свои. Пока какая-то группа выше предела (например,
+    // после lab2_resize), жертвы выбираются из неё. Лимиты общие для всего кэша, но жертва
+    // ищется в шарде нового блока, поэтому резерв соблюдается приблизительно; сумма резервов
+    // должна оставлять место остальным группам.
+    // Возвращает 0 в случае успеха, -1 при неверной группе или min_bytes > max_bytes.
+    LAB2_API int lab2_set_group_limits(int group, size_t min_bytes, size_t max_bytes);
+
+    // Статистика группы: память и лимиты — текущие, счётчики — с последнего сброса
+    struct lab2_group_stats {
+        uint64_t resident_bytes;  // память блоков группы в кэше
+        uint64_t min_bytes;       // резерв (lab2_set_group_limits)
+        uint64_t max_bytes;       // предел, 0 — без предела
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;       // вытесненных блоков группы
+    };
+
+    // Возвращает 0 в случае успеха, -1 при неверной группе или stats == NULL.
+    LAB2_API int lab2_get_group_stats(int group, struct lab2_group_stats *stats);
+
+    // Гистограмма задержек: buckets[i] — число операций длительностью [2^i, 2^(i+1)) нс,
+    // в последнюю корзину попадает всё, что дольше
+    #define LAB2_LATENCY_BUCKETS 40
+    struct lab2_latency {
+        uint64_t count;     // операций
+        uint64_t total_ns;  // суммарное время
+        uint64_t buckets[LAB2_LATENCY_BUCKETS];
+    };
+
+    // Статистика кэша с последнего сброса (print_hm или lab2_reset_stats)
+    struct lab2_stats {
+        uint64_t hits;               // обращений к блокам, найденным в кэше
+        uint64_t misses;             // обращений к блокам, которых в кэше не было
+        uint64_t evictions;          // вытесненных блоков
+        uint64_t dirty_evictions;    // из них записанных на диск перед вытеснением
+        uint64_t prefetch_issued;    // блоков загружено упреждающим чтением
+        uint64_t prefetch_used;      // из них прочитано или перезаписано до вытеснения
+        uint64_t prefetch_wasted;    // вытеснено без единого обращения
+        uint64_t bytes_read;         // байт прочитано через lab2_read/lab2_pread
+        uint64_t bytes_written;      // байт записано через lab2_write/lab2_pwrite
+        uint64_t disk_writes;        // вызовов записи на диск
+        uint64_t disk_write_bytes;   // байт записано на диск
+        uint64_t writeback_batches;  // порций фоновой записи
+        uint64_t writeback_blocks;   // блоков записано фоновой записью
+        struct lab2_latency read_latency;   // lab2_read и lab2_pread
+        struct lab2_latency write_latency;  // lab2_write и lab2_pwrite
+        struct lab2_latency fsync_latency;  // lab2_fsync
+        uint64_t capacity_bytes;     // текущая ёмкость кэша (не сбрасывается)
+        uint64_t huge_page_bytes;    // из неё на больших страницах (не сбрасывается)
+        uint64_t victim_hits;        // промахов, обслуженных ярусом вытесненных блоков
+        uint64_t victim_stores;      // блоков сохранено в ярус при вытеснении
+        uint64_t victim_blocks;      // блоков в ярусе сейчас (не сбрасывается)
+        uint64_t victim_bytes;       // память яруса сейчас (не сбрасывается)
+    };
+
+    // Запись трассы обращений в файл path: каждый вызов lab2_open/close/read/write/
+    // pread/pwrite/fsync и выдача страниц сохраняются как (время, операция, fd, смещение,
+    // длина) в двоичном формате page-cache-trace.h. Трассу воспроизводит trace-replay.
+    // Запись также включается переменной окружения LAB2_TRACE=путь при первом lab2_open.
+    // Повторный lab2_trace_start закрывает текущую трассу и начинает новую.
+    // Возвращает 0 в случае успеха, -1 если файл не удалось создать.
+    LAB2_API int lab2_trace_start(const char *path);
+
+    // Остановка записи трассы; буферизованные записи сбрасываются в файл
+    LAB2_API int lab2_trace_stop(void);
+
+    // Снимок кэша для тёплого старта: в файл path записываются блоки открытых файлов,
+    // лежащие в кэше, — идентичность файла (устройство и inode), номера блоков и ранг по
+    // порядку политики вытеснения. Данные блоков не сохраняются.
+    // Возвращает 0 в случае успеха, -1 если файл не удалось записать.
+    LAB2_API int lab2_save_state(const char *path);
+
+    // Тёплый старт по снимку lab2_save_state: самые горячие блоки снимка (не больше ёмкости
+    // кэша) загружаются в фоне упреждающим чтением — от горячих к холодным, большими сериями
+    // в порядке смещений. Файлы узнаются по идентичности, а не по пути: блоки файла, который
+    // ещё не открыт, загружаются после его lab2_open. lab2_open усекает файл, поэтому для
+    // тёплого старта файлы открываются через lab2_open_flags без LAB2_OPEN_TRUNCATE.
+    // Возвращает 0 в случае успеха, -1 если снимок не прочитан.
+    LAB2_API int lab2_load_state(const char *path);
+
+    // Получение статистики. Счётчики ведутся без блокировок, поэтому снимок при
+    // параллельной работе приблизителен. Возвращает 0 в случае успеха, -1 если stats == NULL.
+    LAB2_API int lab2_get_stats(struct lab2_stats *stats);
+
+    // Обнуление статистики (и счётчиков групп)
+    LAB2_API void lab2_reset_stats(void);
+
+    // Печать статистики в stdout и сброс счётчиков
     LAB2_API void print_hm();
 
 #ifdef __cplusplus